@@ -0,0 +1 @@
+gcc -O3 -DMAX_BULLETS=8192 src/bench.c src/sim.c src/collide.c src/arena.c src/clock.c src/draw.c src/particles.c src/mixer.c src/text.c src/rewind.c -o bench -lm && ./bench "$@"
@@ -0,0 +1 @@
+gcc -O3 src/headless.c src/sim.c src/collide.c src/arena.c src/replay.c src/policy.c src/clock.c -o headless -lm && ./headless "$@"
@@ -0,0 +1 @@
+gcc -O3 src/netplay.c src/net.c src/sim.c src/collide.c src/arena.c src/policy.c src/clock.c -o netplay -lm && ./netplay "$@"
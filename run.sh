@@ -1 +1,2 @@
-gcc src/spaceInvader.c -o prog -lraylib -lm && ./prog
+gcc -O2 src/packer.c src/pack.c -o packer && ./packer assets assets.pak &&
+gcc -O3 src/spaceInvader.c src/sim.c src/collide.c src/arena.c src/clock.c src/draw.c src/particles.c src/pack.c src/scores.c src/saver.c src/profile.c src/replay.c src/mixer.c src/audio.c src/text.c src/snapshot.c src/net.c src/rewind.c -o prog -lraylib -lm -lpthread && ./prog
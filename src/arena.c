@@ -0,0 +1,27 @@
+#include "arena.h"
+#include <stdlib.h>
+
+// Reserva o bloco uma vez so, retorna 0 se nao tiver memoria
+int ArenaInit(Arena* a, size_t size) {
+  a->base = aligned_alloc(ARENA_ALIGN, (size + ARENA_ALIGN - 1) / ARENA_ALIGN * ARENA_ALIGN);
+  a->size = a->base ? size : 0;
+  a->used = 0;
+  return a->base != NULL;
+}
+
+void ArenaFree(Arena* a) {
+  free(a->base);
+  *a = (Arena) { 0 };
+}
+
+void ArenaReset(Arena* a) {
+  a->used = 0;
+}
+
+// Nao zera a memoria; retorna NULL se nao couber
+void* ArenaPush(Arena* a, size_t size) {
+  size_t start = (a->used + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+  if (start + size > a->size) return NULL;
+  a->used = start + size;
+  return a->base + start;
+}
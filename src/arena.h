@@ -0,0 +1,21 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+// Memoria linear: aloca so andando um ponteiro e libera tudo de uma vez no reset
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_ALIGN 64 // Uma linha de cache, cada array comeca alinhado pra vetorizar
+
+typedef struct {
+  uint8_t* base;
+  size_t size, used;
+} Arena;
+
+int   ArenaInit(Arena* a, size_t size);
+void  ArenaFree(Arena* a);
+void  ArenaReset(Arena* a);
+void* ArenaPush(Arena* a, size_t size);
+
+#endif
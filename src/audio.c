@@ -0,0 +1,167 @@
+#include "raylib.h"
+#include "audio.h"
+#include "clock.h"
+#include <pthread.h>
+#include <unistd.h>
+
+static void* AudioThread(void* arg);
+static void  ReadCommands();
+static void  LoadMusic(int frames);
+static void  LoadSfx(int frames);
+static int   Starved(uint64_t now, uint64_t last, int frames, int rate);
+
+Audio audio;
+
+// Tudo abaixo so e tocado pela thread de audio depois do AudioStart
+static pthread_t thread;
+static Mixer* mixer;
+static const unsigned char* music_data;
+static int music_size, music_frames, music_playing;
+static float music_volume = 1;
+static Music music;
+static AudioStream sfx;
+static int sfx_frames;
+static uint64_t music_fill, sfx_fill; // Ultima vez que cada stream foi reposto
+static float sfx_buffer[AUDIO_SFX_MAX * 2];
+
+// O mixer passa a ser da thread de audio; a musica e lida do buffer, que tem que durar ate o AudioStop
+int AudioStart(Mixer* m, const unsigned char* music, int size) {
+  mixer = m;
+  music_data = music;
+  music_size = size;
+  atomic_store(&audio.running, 1);
+  if (pthread_create(&thread, NULL, AudioThread, NULL)) {
+    atomic_store(&audio.running, 0);
+    return 0;
+  }
+  return 1;
+}
+
+void AudioStop() {
+  if (!atomic_load(&audio.running)) return;
+  atomic_store(&audio.running, 0);
+  pthread_join(thread, NULL);
+}
+
+// So a thread do jogo chama; com a fila cheia o comando e descartado
+int AudioSend(AudioCommandType type, int arg, float value) {
+  AudioQueue* q = &audio.queue;
+  uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+  if (tail - head >= AUDIO_QUEUE_SIZE) {
+    atomic_fetch_add(&audio.stats.dropped, 1);
+    return 0;
+  }
+  q->items[tail & (AUDIO_QUEUE_SIZE - 1)] = (AudioCommand) { type, arg, value };
+  atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+  return 1;
+}
+
+// ---
+
+static void* AudioThread(void* arg) {
+  LoadMusic(AUDIO_MUSIC_MIN);
+  LoadSfx(AUDIO_SFX_MIN);
+
+  while (atomic_load(&audio.running)) {
+    ReadCommands();
+    uint64_t now = MonotonicNs(NULL);
+
+    if (music.ctxData && music_playing && IsAudioStreamProcessed(music.stream)) {
+      if (Starved(now, music_fill, music_frames, music.stream.sampleRate)) {
+        atomic_fetch_add(&audio.stats.music_underruns, 1);
+        if (music_frames < AUDIO_MUSIC_MAX) LoadMusic(music_frames * 2);
+      }
+      UpdateMusicStream(music);
+      music_fill = now;
+    }
+
+    if (IsAudioStreamProcessed(sfx)) {
+      if (Starved(now, sfx_fill, sfx_frames, MIXER_RATE)) {
+        atomic_fetch_add(&audio.stats.sfx_underruns, 1);
+        if (sfx_frames < AUDIO_SFX_MAX) LoadSfx(sfx_frames * 2);
+      }
+      while (IsAudioStreamProcessed(sfx)) {
+        MixerRender(mixer, sfx_buffer, sfx_frames);
+        UpdateAudioStream(sfx, sfx_buffer, sfx_frames);
+      }
+      sfx_fill = now;
+    }
+
+    atomic_store(&audio.stats.voices, MixerActiveVoices(mixer));
+    usleep(AUDIO_PERIOD_MS * 1000);
+  }
+
+  if (music.ctxData) UnloadMusicStream(music);
+  UnloadAudioStream(sfx);
+  return NULL;
+}
+
+static void ReadCommands() {
+  AudioQueue* q = &audio.queue;
+  uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+
+  for (; head != tail; head++) {
+    AudioCommand* c = &q->items[head & (AUDIO_QUEUE_SIZE - 1)];
+    switch (c->type) {
+      case AUDIO_PLAY_MUSIC:
+        music_playing = 1;
+        if (music.ctxData) PlayMusicStream(music);
+        music_fill = MonotonicNs(NULL);
+        break;
+      case AUDIO_STOP_MUSIC:
+        music_playing = 0;
+        if (music.ctxData) StopMusicStream(music);
+        break;
+      case AUDIO_MUSIC_VOLUME:
+        music_volume = c->value;
+        if (music.ctxData) SetMusicVolume(music, music_volume);
+        break;
+      case AUDIO_SFX:   MixerPlay(mixer, c->arg, c->value); break;
+      case AUDIO_FLUSH: MixerFlush(mixer); break;
+    }
+  }
+  atomic_store_explicit(&q->head, head, memory_order_release);
+}
+
+// Recria o stream da musica com outro tamanho de buffer, voltando pro mesmo ponto
+static void LoadMusic(int frames) {
+  if (!music_data) return;
+  float played = 0;
+  if (music.ctxData) {
+    played = GetMusicTimePlayed(music);
+    UnloadMusicStream(music);
+  }
+
+  SetAudioStreamBufferSizeDefault(frames);
+  music = LoadMusicStreamFromMemory(".mp3", music_data, music_size);
+  SetAudioStreamBufferSizeDefault(0);
+  music_frames = frames;
+  music_fill = MonotonicNs(NULL);
+  atomic_store(&audio.stats.music_frames, frames);
+  if (!music.ctxData) return;
+
+  SetMusicVolume(music, music_volume);
+  if (music_playing) {
+    PlayMusicStream(music);
+    SeekMusicStream(music, played);
+  }
+}
+
+// Estereo em float na taxa do mixer; os efeitos que estavam tocando continuam no mixer
+static void LoadSfx(int frames) {
+  if (sfx_frames) UnloadAudioStream(sfx);
+  SetAudioStreamBufferSizeDefault(frames);
+  sfx = LoadAudioStream(MIXER_RATE, 32, 2);
+  SetAudioStreamBufferSizeDefault(0);
+  PlayAudioStream(sfx);
+  sfx_frames = frames;
+  sfx_fill = MonotonicNs(NULL);
+  atomic_store(&audio.stats.sfx_frames, frames);
+}
+
+// Depois de repor cabem no maximo dois buffers na fila do device; se passou mais que isso, ele ficou sem dados
+static int Starved(uint64_t now, uint64_t last, int frames, int rate) {
+  return rate && now - last > 2 * (uint64_t) frames * 1000000000 / rate;
+}
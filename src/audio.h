@@ -0,0 +1,58 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+// Thread de audio: decodifica a musica e mixa os efeitos longe do frame
+// O jogo so manda comandos por uma fila lock-free de um produtor e um consumidor
+// Os buffers dobram quando a thread nao consegue repor a tempo, e cada vez conta como underrun
+
+#include "mixer.h"
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define AUDIO_QUEUE_SIZE  1024 // Potencia de 2
+#define AUDIO_PERIOD_MS   2    // Intervalo entre as voltas da thread
+#define AUDIO_MUSIC_MIN   4096 // Frames por buffer da musica
+#define AUDIO_MUSIC_MAX   32768
+#define AUDIO_SFX_MIN     512  // Os efeitos comecam pequenos pra manter a latencia baixa
+#define AUDIO_SFX_MAX     4096
+
+typedef enum {
+  AUDIO_PLAY_MUSIC, AUDIO_STOP_MUSIC, AUDIO_MUSIC_VOLUME,
+  AUDIO_SFX,  // arg = som, value = x
+  AUDIO_FLUSH // Fim do tick, os efeitos pedidos desde o ultimo tocam juntos
+} AudioCommandType;
+
+typedef struct {
+  uint8_t type;
+  int16_t arg;
+  float value;
+} AudioCommand;
+
+typedef struct {
+  AudioCommand items[AUDIO_QUEUE_SIZE];
+  _Atomic uint32_t head; // So a thread de audio escreve
+  char pad[60];
+  _Atomic uint32_t tail; // So o jogo escreve
+  char pad2[60];
+} AudioQueue;
+
+// Lidos pelo jogo so pra mostrar
+typedef struct {
+  atomic_int music_underruns, sfx_underruns;
+  atomic_int music_frames, sfx_frames; // Tamanho atual dos buffers
+  atomic_int voices, dropped;          // dropped = comandos perdidos com a fila cheia
+} AudioStats;
+
+typedef struct {
+  AudioQueue queue;
+  AudioStats stats;
+  atomic_int running;
+} Audio;
+
+extern Audio audio;
+
+int  AudioStart(Mixer* mixer, const unsigned char* music, int music_size);
+void AudioStop();
+int  AudioSend(AudioCommandType type, int arg, float value);
+
+#endif
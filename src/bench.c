@@ -0,0 +1,414 @@
+// Benchmarks headless dos sistemas do jogo
+// Uso: ./bench [--json] [--seed S] [--ticks N] [cenario...]
+// Sem cenario roda todos; --json imprime uma linha JSON por sistema pra comparar entre commits
+
+#include "sim.h"
+#include "draw.h"
+#include "particles.h"
+#include "mixer.h"
+#include "text.h"
+#include "rewind.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FRAMES      600
+#define MAX_SAMPLES 100000
+#define WARMUP      60
+
+// Cada cenario da sim roda os sistemas na ordem do SimTick, medindo um por um
+typedef enum {
+  SYS_ENEMIES_MOVEMENT, SYS_PLAYER_MOVEMENT, SYS_ENEMY_SHOOT,
+  SYS_PLAYER_SHOOT, SYS_BULLETS_COLLISION, SYS_DRAW_LIST, SYS_TICK,
+  SYS_COUNT
+} System;
+
+typedef struct {
+  char* name;
+  int columns, lines;
+  int bullets; // Tiros mantidos no ar todo tick, 0 deixa o jogo atirar sozinho
+} SimScenario;
+
+char* system_names[SYS_COUNT] = {
+  "EnemiesMovement", "PlayerMovement", "EnemyShoot",
+  "PlayerShoot", "BulletsCollision", "DrawList", "Tick"
+};
+
+// O bench.sh aumenta MAX_BULLETS; sem isso o storm e cortado
+SimScenario sim_scenarios[] = {
+  { "stock",   7,  4,  0 },
+  { "level12", 12, 6,  0 },
+  { "wide",    64, 8,  256 },
+  { "huge",    64, 32, 1024 },
+  { "swarm",   96, 32, 0 },
+  { "storm",   7,  4,  8192 },
+};
+
+int json = 0, ticks = 3000;
+uint64_t seed = 1;
+double overhead; // Custo de uma leitura do relogio, descontado das amostras
+double samples[SYS_COUNT][MAX_SAMPLES];
+long allocs;
+
+Game g;
+DrawList draw_list;
+Particles particles;
+Mixer mixer;
+TextFont font;
+TextCache text_cache;
+Rewind rewind_buffer;
+SpriteMasks masks; // Um disco em todos os sprites, a sim testa os pixels como no jogo
+volatile float sink; // Segura resultados que o compilador jogaria fora
+float mix_out[MIXER_RATE / 60 * 2], mix_samples[16][MIXER_RATE / 2];
+
+// ---
+
+// Conta alocacoes por cima do malloc da glibc
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size)            { allocs++; return __libc_malloc(size); }
+void* calloc(size_t n, size_t size)  { allocs++; return __libc_calloc(n, size); }
+void* realloc(void* ptr, size_t size) { allocs++; return __libc_realloc(ptr, size); }
+
+int CompareDoubles(const void* a, const void* b) {
+  double x = *(double*) a, y = *(double*) b;
+  return (x > y) - (x < y);
+}
+
+// Ordena as amostras e imprime media e percentis em ns
+void Report(char* scenario, char* system, double* ns, int n, long allocated, int enemies, int bullets) {
+  qsort(ns, n, sizeof(double), CompareDoubles);
+  double sum = 0;
+  for (int i = 0; i < n; i++) sum += ns[i];
+
+  if (json)
+    printf("{\"scenario\":\"%s\",\"system\":\"%s\",\"seed\":%llu,\"enemies\":%d,\"bullets\":%d,\"samples\":%d,"
+           "\"mean_ns\":%.1f,\"p50_ns\":%.1f,\"p90_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f,\"allocs\":%ld}\n",
+           scenario, system, (unsigned long long) seed, enemies, bullets, n,
+           sum / n, ns[n / 2], ns[n * 90 / 100], ns[n * 99 / 100], ns[n - 1], allocated);
+  else
+    printf("%-16s %-17s mean %10.1f ns  p50 %10.1f  p90 %10.1f  p99 %10.1f  max %10.1f  allocs %ld\n",
+           scenario, system, sum / n, ns[n / 2], ns[n * 90 / 100], ns[n * 99 / 100], ns[n - 1], allocated);
+}
+
+// Mediana de duas leituras seguidas do relogio
+void MeasureOverhead() {
+  for (int i = 0; i < 1000; i++) {
+    uint64_t a = MonotonicNs(NULL);
+    samples[0][i] = MonotonicNs(NULL) - a;
+  }
+  qsort(samples[0], 1000, sizeof(double), CompareDoubles);
+  overhead = samples[0][500];
+}
+
+double Elapsed(uint64_t start) {
+  return MAX(0, (double) (MonotonicNs(NULL) - start) - overhead);
+}
+
+// --- Cenarios da sim
+
+// Mascaras em forma de disco no lugar das imagens, que o bench nao carrega
+void FillMasks() {
+  SpriteMask* all[] = { &masks.player[0], &masks.player[1], &masks.player[2], &masks.enemy[0], &masks.enemy[1], &masks.barrier };
+  for (int i = 0; i < LEN(all); i++)
+    for (int y = 0; y < SPRITE_SIZE; y++)
+      for (int x = 0; x < SPRITE_SIZE; x++)
+        if ((x - 15.5) * (x - 15.5) + (y - 15.5) * (y - 15.5) < 15 * 15) all[i]->rows[y] |= 1u << x;
+}
+
+// Repoe a formacao e as barreiras quando metade ja morreu, fora da medicao
+void Refill(SimScenario* s) {
+  g.over = 0;
+  if (g.enemies.alive_count > g.enemies.count / 2) return;
+  g.bullets.count = 0;
+  g.player.shooting = 0;
+  ArenaReset(&g.arena);
+  InitFormation(&g, s->columns, s->lines);
+  InitBarriers(&g);
+}
+
+// Completa o pool ate o alvo, metade subindo do player e metade caindo dos inimigos
+void TopUpBullets(int target) {
+  Bullets* b = &g.bullets;
+  Formation* f = &g.enemies;
+  while (b->count < MIN(target, MAX_BULLETS)) {
+    int n = b->count++;
+    if (n % 2 || !f->alive_count) {
+      b->x[n] = SimRandom(&g, 0, WINDOW_WIDTH);
+      b->y[n] = g.player.pos.y;
+      b->vy[n] = -15;
+      b->owner[n] = OWNER_PLAYER;
+      b->shooter[n] = -1;
+      g.player.shooting++;
+    } else {
+      int k;
+      do k = SimRandom(&g, 0, f->count - 1); while (!f->alive[k]);
+      b->x[n] = f->x[k] + f->size / 2;
+      b->y[n] = f->y[k] + f->size / 2;
+      b->vy[n] = g.enemy_bullet_speed;
+      b->owner[n] = OWNER_ENEMY;
+      b->shooter[n] = k;
+      f->shooting[k] = 1;
+    }
+  }
+}
+
+// Mesmos comandos que DrawEnemies, DrawBullets e DrawBarriers empilham, ate a ordenacao
+void BuildDrawList() {
+  Rectangle src = { 0, 0, 32, 32 };
+  DrawListClear(&draw_list);
+
+  Formation* f = &g.enemies;
+  for (int k = 0; k < f->count; k++) {
+    if (!f->alive[k]) continue;
+    if (!DrawListPush(&draw_list, LAYER_SPRITES, 0, src, EnemyRec(f, k), 0xffffffff)) {
+      DrawListSort(&draw_list);
+      DrawListClear(&draw_list);
+    }
+  }
+  for (int n = 0; n < g.bullets.count; n++) {
+    if (!DrawListPush(&draw_list, LAYER_BULLETS, 0, src, BulletRec(&g.bullets, n), 0xff00ff00)) {
+      DrawListSort(&draw_list);
+      DrawListClear(&draw_list);
+    }
+  }
+  for (int i = 0; i < LEN(g.barriers); i++)
+    if (g.barriers[i].hp) DrawListPush(&draw_list, LAYER_SPRITES, 0, src, g.barriers[i].pos, 0xffffffff);
+  DrawListPush(&draw_list, LAYER_SPRITES, 0, src, g.player.pos, 0xffffffff);
+  DrawListSort(&draw_list);
+}
+
+void BenchSim(SimScenario* s) {
+  long system_allocs[SYS_COUNT] = { 0 };
+  int n = MIN(ticks, MAX_SAMPLES);
+
+  SimInit(&g, seed);
+  SimNewRun(&g);
+  SimStartRound(&g);
+  g.masks = &masks;
+  g.player.hp = 1 << 30; // Nunca perde, so o custo importa
+  g.timer = 1 << 20;
+  g.player_bullets = s->bullets ? MAX_BULLETS : PLAYER_BULLETS;
+  g.swarm = SWARM_MODE && s->columns * s->lines > MAX_COLUMNS * MAX_LINES;
+  g.enemies.alive_count = 0;
+  Refill(s);
+
+  for (int t = -WARMUP; t < n; t++) {
+    Refill(s);
+    TopUpBullets(s->bullets);
+    g.tick++;
+    g.num_events = 0;
+    Input input = IN_SHOOT | ((g.tick / TICK_RATE) % 2 ? IN_LEFT : IN_RIGHT);
+    double ns[SYS_COUNT];
+    long before = allocs, a;
+    uint64_t start, tick_start = MonotonicNs(NULL);
+
+    a = allocs; start = MonotonicNs(NULL); EnemiesMovement(&g);       ns[SYS_ENEMIES_MOVEMENT]  = Elapsed(start); system_allocs[SYS_ENEMIES_MOVEMENT]  += allocs - a;
+    a = allocs; start = MonotonicNs(NULL); PlayerMovement(&g, input); ns[SYS_PLAYER_MOVEMENT]   = Elapsed(start); system_allocs[SYS_PLAYER_MOVEMENT]   += allocs - a;
+    a = allocs; start = MonotonicNs(NULL); EnemyShoot(&g);            ns[SYS_ENEMY_SHOOT]       = Elapsed(start); system_allocs[SYS_ENEMY_SHOOT]       += allocs - a;
+    a = allocs; start = MonotonicNs(NULL); PlayerShoot(&g, input);    ns[SYS_PLAYER_SHOOT]      = Elapsed(start); system_allocs[SYS_PLAYER_SHOOT]      += allocs - a;
+    a = allocs; start = MonotonicNs(NULL); BulletsCollision(&g);      ns[SYS_BULLETS_COLLISION] = Elapsed(start); system_allocs[SYS_BULLETS_COLLISION] += allocs - a;
+    ns[SYS_TICK] = Elapsed(tick_start);
+    system_allocs[SYS_TICK] += allocs - before;
+    a = allocs; start = MonotonicNs(NULL); BuildDrawList();           ns[SYS_DRAW_LIST]         = Elapsed(start); system_allocs[SYS_DRAW_LIST]         += allocs - a;
+
+    if (t < 0) continue;
+    for (int sys = 0; sys < SYS_COUNT; sys++) samples[sys][t] = ns[sys];
+  }
+
+  for (int sys = 0; sys < SYS_COUNT; sys++)
+    Report(s->name, system_names[sys], samples[sys], n, system_allocs[sys], g.enemies.count, MIN(s->bullets, MAX_BULLETS));
+  SimFree(&g);
+}
+
+// GenerateMap em todos os levels ate o maior enxame
+void BenchGenerate() {
+  int n = MIN(ticks, MAX_SAMPLES);
+  SimInit(&g, seed);
+  SimNewRun(&g);
+  long a = allocs;
+  for (int t = 0; t < n; t++) {
+    g.level = 1 + t % 30;
+    uint64_t start = MonotonicNs(NULL);
+    GenerateMap(&g);
+    samples[0][t] = Elapsed(start);
+  }
+  Report("generate", "GenerateMap", samples[0], n, allocs - a, g.enemies.count, 0);
+  SimFree(&g);
+}
+
+// --- Particulas
+
+// Particulas vivas no frame: mantem o pool perto da capacidade emitindo explosoes toda hora
+void BenchParticles() {
+  int targets[] = { 10000, 50000, 100000, 130000 };
+
+  for (int t = 0; t < LEN(targets); t++) {
+    ParticlesInit(&particles, seed);
+    long a = allocs;
+
+    for (int f = 0; f < FRAMES; f++) {
+      uint64_t start = MonotonicNs(NULL);
+      while (particles.count < targets[t])
+        ParticlesBurst(&particles, 120, 400, 300, 5, 60, 3, 0xffffffff);
+      ParticlesUpdate(&particles, 1, 0.15);
+      ParticlesWrap(&particles, -2, 600);
+      ParticlesReap(&particles);
+      samples[0][f] = Elapsed(start);
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "particles-%d", targets[t]);
+    Report(name, "Particles", samples[0], FRAMES, allocs - a, 0, 0);
+  }
+}
+
+// --- Mixer
+
+// Um tick de audio com cada vez mais pedidos: o flush junta e o render fica preso nas vozes do pool
+void BenchMixer() {
+  int requests[] = { 1, 16, 256, 4096 };
+
+  // Senoides de meio segundo no lugar dos wavs
+  MixerInit(&mixer, WINDOW_WIDTH);
+  for (int s = 0; s < LEN(mix_samples); s++) {
+    for (int i = 0; i < LEN(mix_samples[s]); i++) mix_samples[s][i] = 0.3f * sinf(i * (200 + 50 * s) * 6.2831853f / MIXER_RATE);
+    MixerAddSound(&mixer, mix_samples[s], LEN(mix_samples[s]), 1 + s % 6, 1);
+  }
+
+  uint64_t rng = seed | 1;
+  for (int r = 0; r < LEN(requests); r++) {
+    long a = allocs;
+    for (int f = 0; f < FRAMES; f++) {
+      uint64_t start = MonotonicNs(NULL);
+      for (int i = 0; i < requests[r]; i++) {
+        rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+        MixerPlay(&mixer, rng % LEN(mix_samples), rng >> 32 & 1023);
+      }
+      MixerFlush(&mixer);
+      MixerRender(&mixer, mix_out, MIXER_RATE / 60);
+      samples[0][f] = Elapsed(start);
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "mixer-%d", requests[r]);
+    Report(name, "Mixer", samples[0], FRAMES, allocs - a, 0, 0);
+  }
+}
+
+// --- Texto
+
+// As strings de uma tela de menu por frame, achando o layout no cache ou montando tudo de novo
+void BenchText() {
+  char* strings[] = {
+    "SPACE INVADERS", "SPACE INVADERS", ">NICKNAME<", "ABC", "ABC",
+    "ABC 1200", "DEF 950", "GHI 800", "JKL 420", "MNO 10", "- Hit Enter -", "REPLAY 4x"
+  };
+
+  // Fonte monoespacada de mentira no lugar da padrao do raylib
+  font = (TextFont) { 10, 0, 1 };
+  for (int i = 0; i < TEXT_GLYPHS; i++)
+    font.glyphs[i] = (TextGlyph) { { i % 16 * 8, i / 16 * 10, 6, 10 }, 0, 0, 6 };
+
+  for (int cached = 1; cached >= 0; cached--) {
+    TextCacheClear(&text_cache);
+    long a = allocs;
+    for (int f = 0; f < FRAMES; f++) {
+      uint64_t start = MonotonicNs(NULL);
+      if (!cached) TextCacheClear(&text_cache);
+      float sum = 0;
+      for (int i = 0; i < LEN(strings); i++) sum += TextLayoutGet(&text_cache, &font, strings[i], 40 + i)->width;
+      samples[0][f] = Elapsed(start);
+      sink = sum;
+    }
+    Report(cached ? "text-cached" : "text-uncached", "TextLayout", samples[0], FRAMES, allocs - a, 0, 0);
+  }
+}
+
+// --- Rewind
+
+// Um round jogando sozinho, gravando todo tick; depois volta pra ticks aleatorios da janela, como quem arrasta a barra
+void BenchRewind() {
+  int levels[] = { 1, SWARM_LEVEL + 5 };
+  char* names[] = { "rewind-stock", "rewind-swarm" };
+  int n = MIN(ticks, MAX_SAMPLES);
+
+  for (int l = 0; l < LEN(levels); l++) {
+    SimInit(&g, seed);
+    SimNewRun(&g);
+    g.level = levels[l] - 1;
+    SimStartRound(&g);
+    g.player.hp = 1 << 30;
+    g.timer = 1 << 20;
+    RewindInit(&rewind_buffer, REWIND_BUDGET);
+
+    long a = allocs;
+    for (int t = 0; t < n; t++) {
+      Input input = IN_SHOOT | ((g.tick / TICK_RATE) % 2 ? IN_LEFT : IN_RIGHT);
+      if (g.over) SimStartRound(&g);
+      g.player.hp = 1 << 30;
+      SimTick(&g, input);
+      uint64_t start = MonotonicNs(NULL);
+      RewindPush(&rewind_buffer, &g);
+      samples[0][t] = Elapsed(start);
+    }
+    Report(names[l], "RewindPush", samples[0], n, allocs - a, g.enemies.count, g.bullets.count);
+    long frames = rewind_buffer.count;
+    double per_tick = (double) rewind_buffer.bytes / frames;
+
+    // Metade pra tras um tick por vez (o pior caso, recomeca no keyframe) e metade pulando pra qualquer lugar
+    uint64_t rng = seed | 1;
+    int64_t first = RewindFirst(&rewind_buffer), last = RewindLast(&rewind_buffer), at = last;
+    a = allocs;
+    for (int t = 0; t < n; t++) {
+      rng ^= rng << 13, rng ^= rng >> 7, rng ^= rng << 17;
+      at = t % 2 ? MAX(first, at - 1) : first + (int64_t) (rng % (last - first + 1));
+      uint64_t start = MonotonicNs(NULL);
+      RewindSeek(&rewind_buffer, &g, at);
+      samples[0][t] = Elapsed(start);
+    }
+    Report(names[l], "RewindSeek", samples[0], n, allocs - a, g.enemies.count, g.bullets.count);
+    // A janela e o que acaba primeiro: os bytes do anel ou o teto do indice
+    if (!json)
+      printf("%-16s %ld frames  %.0f bytes/tick  %.1f s in %d MB (%ld frames evicted)\n", names[l], frames, per_tick,
+             MIN(REWIND_BUDGET / per_tick, REWIND_MAX_FRAMES) / TICK_RATE, REWIND_BUDGET >> 20, rewind_buffer.evicted);
+
+    RewindFree(&rewind_buffer);
+    SimFree(&g);
+  }
+}
+
+// ---
+
+int Selected(char** names, int count, char* name) {
+  if (!count) return 1;
+  for (int i = 0; i < count; i++)
+    if (!strcmp(names[i], name)) return 1;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  char* names[64];
+  int count = 0;
+  for (int i = 1; i < argc; i++) {
+    if      (!strcmp(argv[i], "--json"))                json  = 1;
+    else if (!strcmp(argv[i], "--seed")  && i + 1 < argc) seed  = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--ticks") && i + 1 < argc) ticks = atoi(argv[++i]);
+    else if (count < LEN(names)) names[count++] = argv[i];
+  }
+  if (ticks < 1) ticks = 1;
+
+  MeasureOverhead();
+  FillMasks();
+  for (int i = 0; i < LEN(sim_scenarios); i++)
+    if (Selected(names, count, sim_scenarios[i].name)) BenchSim(&sim_scenarios[i]);
+  if (Selected(names, count, "generate"))  BenchGenerate();
+  if (Selected(names, count, "particles")) BenchParticles();
+  if (Selected(names, count, "mixer"))     BenchMixer();
+  if (Selected(names, count, "text"))      BenchText();
+  if (Selected(names, count, "rewind"))    BenchRewind();
+  return 0;
+}
@@ -0,0 +1,51 @@
+#include "clock.h"
+#include <time.h>
+
+#define NS_PER_SECOND 1000000000ULL
+
+// Relogio padrao, pode ser trocado por um falso em testes ou replays
+uint64_t MonotonicNs(void* ctx) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * NS_PER_SECOND + ts.tv_nsec;
+}
+
+uint64_t ClockNow(Clock* clock) {
+  return clock->now(clock->ctx);
+}
+
+void StepperInit(Stepper* s, Clock clock) {
+  *s = (Stepper) { .clock = clock };
+  StepperReset(s);
+}
+
+// Esquece o tempo acumulado, usado ao entrar numa tela que simula
+void StepperReset(Stepper* s) {
+  s->last = ClockNow(&s->clock);
+  s->acc  = 0;
+}
+
+// Retorna quantos ticks rodar agora; frames lentos geram ticks de recuperacao
+int StepperAdvance(Stepper* s) {
+  uint64_t now = ClockNow(&s->clock);
+  s->acc += (now - s->last) * TICK_RATE;
+  s->last = now;
+
+  int ticks = s->acc / NS_PER_SECOND;
+  s->acc %= NS_PER_SECOND;
+  if (ticks > MAX_CATCHUP) {
+    s->dropped += ticks - MAX_CATCHUP;
+    ticks = MAX_CATCHUP;
+  }
+  return ticks;
+}
+
+// Fracao do proximo tick ja passada, pra desenhar entre o estado anterior e o atual
+float StepperAlpha(Stepper* s) {
+  return (float) s->acc / NS_PER_SECOND;
+}
+
+// Nanossegundos ate o proximo tick, contando do ultimo StepperAdvance
+uint64_t StepperUntilNext(Stepper* s) {
+  return (NS_PER_SECOND - s->acc + TICK_RATE - 1) / TICK_RATE;
+}
@@ -0,0 +1,31 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+// Relogio monotonico inteiro em nanossegundos e passo fixo da simulacao
+
+#include <stdint.h>
+
+#define TICK_RATE   60
+#define MAX_CATCHUP 15 // Ticks maximos por frame, o resto do atraso e descartado
+
+typedef struct {
+  uint64_t (*now)(void* ctx);
+  void* ctx;
+} Clock;
+
+typedef struct {
+  Clock clock;
+  uint64_t last;
+  uint64_t acc; // Em ns * TICK_RATE pra nao acumular erro de arredondamento
+  uint64_t dropped;
+} Stepper;
+
+uint64_t MonotonicNs(void* ctx);
+uint64_t ClockNow(Clock* clock);
+void     StepperInit(Stepper* s, Clock clock);
+void     StepperReset(Stepper* s);
+int      StepperAdvance(Stepper* s);
+float    StepperAlpha(Stepper* s);
+uint64_t StepperUntilNext(Stepper* s);
+
+#endif
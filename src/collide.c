@@ -0,0 +1,147 @@
+#include "collide.h"
+#include <math.h>
+
+static void Cells(Rectangle rec, int* i0, int* i1, int* j0, int* j1);
+static int  Cell(float v, int count);
+static int  Slab(float p, float size, float d, float q, float q_size, float* enter, float* leave);
+
+void GridClear(CollideGrid* grid) {
+  grid->count = grid->links = 0;
+  grid->query = 0;
+  grid->bounds = (Rectangle) { 0 };
+  for (int c = 0; c < LEN(grid->head); c++) grid->head[c] = -1;
+}
+
+// Retorna 0 se a grade encheu; o corpo fica de fora
+int GridInsert(CollideGrid* grid, Rectangle rec, float dx, float dy, int id) {
+  int i0, i1, j0, j1;
+  Rectangle hull = SweptRec(rec, dx, dy);
+  Cells(hull, &i0, &i1, &j0, &j1);
+  if (grid->count == COLLIDE_BODIES || grid->links + (i1 - i0 + 1) * (j1 - j0 + 1) > COLLIDE_LINKS) return 0;
+
+  if (!grid->count) grid->bounds = hull;
+  float x1 = MAX(grid->bounds.x + grid->bounds.width,  hull.x + hull.width);
+  float y1 = MAX(grid->bounds.y + grid->bounds.height, hull.y + hull.height);
+  grid->bounds.x = MIN(grid->bounds.x, hull.x);
+  grid->bounds.y = MIN(grid->bounds.y, hull.y);
+  grid->bounds.width  = x1 - grid->bounds.x;
+  grid->bounds.height = y1 - grid->bounds.y;
+
+  int b = grid->count++;
+  grid->bodies[b] = (CollideBody) { rec, hull, dx, dy, id };
+  grid->seen[b] = grid->query;
+  for (int j = j0; j <= j1; j++) {
+    for (int i = i0; i <= i1; i++) {
+      int link = grid->links++, c = j * COLLIDE_COLUMNS + i;
+      grid->body[link] = b;
+      grid->next[link] = grid->head[c];
+      grid->head[c] = link;
+    }
+  }
+  return 1;
+}
+
+// Indices (em bodies) dos corpos cujo caminho encosta na area, no maximo max
+int GridQuery(CollideGrid* grid, Rectangle area, int* bodies, int max) {
+  int i0, i1, j0, j1, found = 0;
+  if (!grid->count || !RecsOverlap(grid->bounds, area)) return 0;
+  Cells(area, &i0, &i1, &j0, &j1);
+  grid->query++;
+  for (int j = j0; j <= j1; j++) {
+    for (int i = i0; i <= i1; i++) {
+      for (int link = grid->head[j * COLLIDE_COLUMNS + i]; link >= 0; link = grid->next[link]) {
+        int b = grid->body[link];
+        if (grid->seen[b] == grid->query || !RecsOverlap(grid->bodies[b].hull, area)) continue;
+        grid->seen[b] = grid->query;
+        if (found < max) bodies[found++] = b;
+      }
+    }
+  }
+  return found;
+}
+
+// Instante em [0, 1) em que a, andando (dx, dy) no passo, comeca a sobrepor b parado; COLLIDE_MISS se nao encosta
+// Pra dois que se movem, passa a velocidade de um relativa ao outro
+float SweepRecs(Rectangle a, float dx, float dy, Rectangle b) {
+  float enter = 0, leave = 1;
+  if (!Slab(a.x, a.width,  dx, b.x, b.width,  &enter, &leave)) return COLLIDE_MISS;
+  if (!Slab(a.y, a.height, dy, b.y, b.height, &enter, &leave)) return COLLIDE_MISS;
+  return enter;
+}
+
+// Refina o contato que o SweepRecs achou em enter com os pixels opacos da mascara esticada sobre b
+// Anda pelas linhas do sprite na ordem em que o tiro entra nelas e faz o AND da linha com as colunas
+// que ele cobre enquanto esta nela; para quando a proxima linha ja comeca depois do melhor contato
+float SweepMask(Rectangle a, float dx, float dy, Rectangle b, const SpriteMask* mask, float enter) {
+  if (enter >= COLLIDE_MISS) return COLLIDE_MISS;
+  float sx = SPRITE_SIZE / b.width, sy = SPRITE_SIZE / b.height, best = COLLIDE_MISS;
+  Rectangle path = SweptRec(a, dx, dy);
+  int r0 = MAX(0, (int) floorf((path.y - b.y) * sy));
+  int r1 = MIN(SPRITE_SIZE - 1, (int) ceilf((path.y + path.height - b.y) * sy) - 1);
+
+  for (int n = 0; n <= r1 - r0; n++) {
+    int r = dy < 0 ? r1 - n : r0 + n;
+    float t0 = enter, t1 = 1;
+    if (!mask->rows[r] || !Slab(a.y, a.height, dy, b.y + r / sy, 1 / sy, &t0, &t1)) continue;
+    if (t0 >= best) break;
+
+    float x0 = a.x + dx * (dx < 0 ? t1 : t0), x1 = a.x + a.width + dx * (dx < 0 ? t0 : t1);
+    int c0 = MAX(0, (int) floorf((x0 - b.x) * sx));
+    int c1 = MIN(SPRITE_SIZE - 1, (int) ceilf((x1 - b.x) * sx) - 1);
+    uint32_t hit = c0 <= c1 ? mask->rows[r] & ((2u << c1) - 1) & ~((1u << c0) - 1) : 0;
+    if (!hit) continue;
+
+    // Andando de lado ele encosta quando chega na primeira coluna opaca, que pode ser depois de entrar na linha
+    if (dx > 0) t0 = MAX(t0, (b.x + __builtin_ctz(hit) / sx - (a.x + a.width)) / dx);
+    if (dx < 0) t0 = MAX(t0, (b.x + (SPRITE_SIZE - __builtin_clz(hit)) / sx - a.x) / dx);
+    best = MIN(best, t0);
+  }
+  return best;
+}
+
+// Caixa de todo o caminho do passo, pra broadphase
+Rectangle SweptRec(Rectangle rec, float dx, float dy) {
+  return (Rectangle) { rec.x + MIN(0, dx), rec.y + MIN(0, dy), rec.width + fabsf(dx), rec.height + fabsf(dy) };
+}
+
+// Celulas de uma grade de itens size x size a cada spacing, a partir de (x0, y0), que podem encostar na area
+// Com uma de folga pra cada lado, quem chama limita aos indices validos
+void CellRange(float x0, float y0, float spacing, float size, Rectangle area, int* i0, int* i1, int* j0, int* j1) {
+  *i0 = (int) floorf((area.x - size - x0) / spacing);
+  *i1 = (int) floorf((area.x + area.width - x0) / spacing) + 1;
+  *j0 = (int) floorf((area.y - size - y0) / spacing);
+  *j1 = (int) floorf((area.y + area.height - y0) / spacing) + 1;
+}
+
+// ---
+
+// Fora da tela vai pras celulas da borda
+static void Cells(Rectangle rec, int* i0, int* i1, int* j0, int* j1) {
+  *i0 = Cell(rec.x, COLLIDE_COLUMNS);
+  *i1 = Cell(rec.x + rec.width, COLLIDE_COLUMNS);
+  *j0 = Cell(rec.y, COLLIDE_ROWS);
+  *j1 = Cell(rec.y + rec.height, COLLIDE_ROWS);
+}
+
+// O cast corta pra zero em vez de arredondar pra baixo, mas negativo vai pra celula 0 de qualquer jeito
+static int Cell(float v, int count) {
+  int c = (int) (v / COLLIDE_CELL);
+  return c < 0 ? 0 : c >= count ? count - 1 : c;
+}
+
+// Um eixo: o intervalo [p, p + size) andando d sobrepoe [q, q + q_size) entre t0 e t1; estreita [enter, leave)
+// Parado, ou sobrepoe o passo todo ou nunca, igual ao RecsOverlap
+static int Slab(float p, float size, float d, float q, float q_size, float* enter, float* leave) {
+  // Se nem o caminho todo encosta, sai sem dividir
+  if (p + MIN(0, d) >= q + q_size || p + size + MAX(0, d) <= q) return 0;
+  if (d == 0) return 1;
+  float t0 = (q - (p + size)) / d, t1 = (q + q_size - p) / d;
+  if (t0 > t1) {
+    float t = t0;
+    t0 = t1;
+    t1 = t;
+  }
+  *enter = MAX(*enter, t0);
+  *leave = MIN(*leave, t1);
+  return *enter < *leave;
+}
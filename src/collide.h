@@ -0,0 +1,43 @@
+#ifndef COLLIDE_H
+#define COLLIDE_H
+
+// Colisao de retangulos: grade uniforme pra achar candidatos e teste varrido (continuo) pra quem se move
+// O teste varrido acha o instante do primeiro contato no passo, entao um tiro rapido nao atravessa alvo fino
+// Dois corpos andando sao testados pela velocidade de um relativa ao outro, parado no comeco do passo
+// A mascara refina o contato do retangulo: so conta quando o tiro passa por cima de um pixel opaco
+// A grade e montada de novo todo tick, na pilha de quem usa; cada corpo fica em todas as celulas que o caminho dele encosta
+
+#include "sim.h"
+
+#define COLLIDE_CELL    64
+#define COLLIDE_COLUMNS (WINDOW_WIDTH  / COLLIDE_CELL + 1)
+#define COLLIDE_ROWS    (WINDOW_HEIGHT / COLLIDE_CELL + 1)
+#define COLLIDE_BODIES  64
+#define COLLIDE_LINKS   256 // Pares (celula, corpo)
+#define COLLIDE_MISS    2.0f // Instante de quem nao encosta no passo, maior que qualquer contato
+
+// rec e onde o corpo comecou o passo, (dx, dy) quanto ele andou e hull a caixa do caminho todo
+typedef struct {
+  Rectangle rec, hull;
+  float dx, dy;
+  int id;
+} CollideBody;
+
+typedef struct {
+  CollideBody bodies[COLLIDE_BODIES];
+  int count, links;
+  Rectangle bounds; // Caixa de todos os corpos, pra busca longe deles sair antes de olhar celula
+  int16_t head[COLLIDE_ROWS * COLLIDE_COLUMNS]; // Primeiro link da celula, -1 se vazia
+  int16_t next[COLLIDE_LINKS], body[COLLIDE_LINKS];
+  uint32_t seen[COLLIDE_BODIES], query; // Pra uma busca nao devolver o mesmo corpo duas vezes
+} CollideGrid;
+
+void  GridClear(CollideGrid* grid);
+int   GridInsert(CollideGrid* grid, Rectangle rec, float dx, float dy, int id);
+int   GridQuery(CollideGrid* grid, Rectangle area, int* bodies, int max);
+float SweepRecs(Rectangle a, float dx, float dy, Rectangle b);
+float SweepMask(Rectangle a, float dx, float dy, Rectangle b, const SpriteMask* mask, float enter);
+Rectangle SweptRec(Rectangle rec, float dx, float dy);
+void  CellRange(float x0, float y0, float spacing, float size, Rectangle area, int* i0, int* i1, int* j0, int* j1);
+
+#endif
@@ -0,0 +1,37 @@
+#include "draw.h"
+
+void DrawListClear(DrawList* d) {
+  d->count = 0;
+}
+
+// Retorna 0 se a lista estiver cheia, ai quem chamou deve enviar e limpar
+int DrawListPush(DrawList* d, DrawLayer layer, int texture, Rectangle src, Rectangle dst, uint32_t tint) {
+  if (d->count == MAX_DRAW_CMDS) return 0;
+  d->cmds[d->count++] = (DrawCmd) { layer, texture, tint, src, dst };
+  return 1;
+}
+
+// Counting sort estavel por (camada, textura), mantendo a ordem de chegada dentro de cada chave
+// Tambem conta quantos lotes e vertices o envio vai gerar
+DrawCmd* DrawListSort(DrawList* d) {
+  int start[MAX_LAYERS * MAX_TEXTURES] = { 0 };
+  for (int n = 0; n < d->count; n++)
+    start[d->cmds[n].layer * MAX_TEXTURES + d->cmds[n].texture]++;
+
+  for (int key = 0, sum = 0; key < LEN(start); key++) {
+    int c = start[key];
+    start[key] = sum;
+    sum += c;
+  }
+
+  for (int n = 0; n < d->count; n++)
+    d->sorted[start[d->cmds[n].layer * MAX_TEXTURES + d->cmds[n].texture]++] = d->cmds[n];
+
+  // Um lote novo so quando a textura muda
+  d->batches  = d->count > 0;
+  d->vertices = d->count * 4;
+  for (int n = 1; n < d->count; n++)
+    d->batches += d->sorted[n].texture != d->sorted[n - 1].texture;
+
+  return d->sorted;
+}
@@ -0,0 +1,34 @@
+#ifndef DRAW_H
+#define DRAW_H
+
+// Lista de comandos de desenho montada na CPU e ordenada antes de enviar
+// Nao depende do raylib; quem envia e a camada de apresentacao
+
+#include "sim.h"
+#include <stdint.h>
+
+#define MAX_DRAW_CMDS 8192
+#define MAX_LAYERS    8
+#define MAX_TEXTURES  8
+
+typedef enum {
+  LAYER_BULLETS, LAYER_SPRITES, LAYER_HUD, LAYER_TEXT
+} DrawLayer;
+
+typedef struct {
+  uint8_t layer, texture;
+  uint32_t tint; // RGBA, um byte por canal
+  Rectangle src, dst;
+} DrawCmd;
+
+typedef struct {
+  DrawCmd cmds[MAX_DRAW_CMDS], sorted[MAX_DRAW_CMDS];
+  int count;
+  int batches, vertices; // Do ultimo DrawListSort
+} DrawList;
+
+void DrawListClear(DrawList* d);
+int  DrawListPush(DrawList* d, DrawLayer layer, int texture, Rectangle src, Rectangle dst, uint32_t tint);
+DrawCmd* DrawListSort(DrawList* d);
+
+#endif
@@ -0,0 +1,141 @@
+// Roda rounds sem janela, audio nem GPU, com a entrada vinda de uma politica
+// Uso: ./headless [--mode 0-2] [--rounds N] [--seed S] [--policy idle|random|track]
+//                 [--player-bullets N] [--fire-delay TICKS] [--level N] [--record FILE]
+//       ./headless --replay FILE   re-simula um replay sem limite de velocidade e confere o resultado
+
+#include "sim.h"
+#include "replay.h"
+#include "policy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_ROUND_TICKS (TICK_RATE * 120)
+
+double Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Roda o replay inteiro e compara com o resultado gravado; 0 se bateu
+int RunReplay(const char* path) {
+  ReplayPlayer p;
+  Game g;
+  if (!ReplayLoad(&p, path)) {
+    fprintf(stderr, "Could not read replay %s\n", path);
+    return 1;
+  }
+  if (!SimInit(&g, 1)) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  ReplayStart(&p, &g);
+
+  ReplayStep step;
+  Input input, used = 0;
+  double start = Now();
+  while ((step = ReplayNext(&p, &input)) == REPLAY_TICK || step == REPLAY_ROUND) {
+    if (step == REPLAY_ROUND) SimStartRound(&g);
+    else {
+      SimTick(&g, input);
+      used |= input;
+    }
+  }
+  double elapsed = Now() - start;
+
+  long ticks = g.tick - p.header.tick;
+  int ok = step == REPLAY_END && g.pts == p.pts && g.level == p.level && ticks == p.ticks;
+  printf("replay %s nick %.3s mode %d\n", path, p.header.nick, p.header.mode);
+  printf("recorded level %d pts %d ticks %ld\n", p.level, p.pts, (long) p.ticks);
+  printf("simulated level %d pts %d ticks %ld in %.3fs (%.0f ticks/s)\n", g.level, g.pts, ticks, elapsed, ticks / elapsed);
+  if (used & (IN_WIN | IN_LOSE)) printf("debug keys F2/F3 were used\n");
+  printf("%s\n", step == REPLAY_ERROR ? "TRUNCATED" : ok ? "OK" : "MISMATCH");
+
+  ReplayUnload(&p);
+  SimFree(&g);
+  return ok ? 0 : 2;
+}
+
+// ---
+
+int main(int argc, char** argv) {
+  int mode = NORMAL, rounds = 100, level = 1;
+  int player_bullets = PLAYER_BULLETS, fire_delay = PLAYER_FIRE_DELAY;
+  uint64_t seed = 1;
+  Policy policy = PolicyTrack;
+  char* record = NULL;
+
+  for (int i = 1; i < argc - 1; i++)
+    if (!strcmp(argv[i], "--replay")) return RunReplay(argv[i + 1]);
+
+  for (int i = 1; i < argc - 1; i++) {
+    if      (!strcmp(argv[i], "--mode"))   mode   = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--rounds")) rounds = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--seed"))   seed   = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--player-bullets")) player_bullets = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--fire-delay"))     fire_delay     = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--level"))          level          = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--record"))         record         = argv[++i];
+    else if (!strcmp(argv[i], "--policy")) policy = PolicyByName(argv[++i]);
+  }
+
+  level = MAX(1, level);
+  mode = MIN(HARDCORE, MAX(NORMAL, mode)); // Indexa as tabelas de dificuldade
+  Game g;
+  if (!SimInit(&g, seed)) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  g.player_bullets    = player_bullets;
+  g.player_fire_delay = fire_delay;
+  SimNewRun(&g);
+  g.mode = mode;
+  g.level = level - 1;
+
+  // So a primeira partida e gravada
+  ReplayRecorder recorder = { 0 };
+  if (record) ReplayBegin(&recorder, &g, "BOT");
+
+  PolicyState policy_state = { seed, 0 };
+  long total_ticks = 0;
+  int wins = 0, best_level = 0, best_pts = 0;
+  double start = Now();
+
+  for (int r = 0; r < rounds; r++) {
+    long tick = 0;
+    SimStartRound(&g);
+    ReplayRound(&recorder);
+    while (!g.over && tick < MAX_ROUND_TICKS) {
+      Input input = policy(&g, &policy_state);
+      tick++;
+      SimTick(&g, input);
+      ReplayTick(&recorder, input);
+    }
+    total_ticks += tick;
+
+    printf("round %d level %d %s pts %d ticks %ld\n", r, g.level, g.winner ? "won" : "lost", g.pts, tick);
+    best_level = MAX(best_level, g.level);
+    best_pts   = MAX(best_pts, g.pts);
+    // Derrota volta pro comeco, igual ao menu do jogo
+    if (g.winner) wins++;
+    else {
+      ReplayEnd(&recorder, &g);
+      SimNewRun(&g);
+      g.mode = mode;
+      g.level = level - 1;
+    }
+  }
+
+  double elapsed = Now() - start;
+  if (record) {
+    ReplayEnd(&recorder, &g);
+    if (!ReplaySave(&recorder, record)) fprintf(stderr, "Could not write replay %s\n", record);
+    ReplayDiscard(&recorder);
+  }
+  printf("rounds %d wins %d best_level %d best_pts %d\n", rounds, wins, best_level, best_pts);
+  printf("ticks %ld in %.3fs (%.0f ticks/s)\n", total_ticks, elapsed, total_ticks / elapsed);
+  SimFree(&g);
+  return 0;
+}
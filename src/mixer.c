@@ -0,0 +1,118 @@
+#include "mixer.h"
+#include <string.h>
+#include <math.h>
+
+static int  StealVoice(Mixer* m, int sound);
+static void StartVoice(Mixer* m, int sound, float x, float gain);
+static void MixVoice(float* restrict left, float* restrict right, const float* restrict src, int n, float gl, float gr);
+
+void MixerInit(Mixer* m, float width) {
+  memset(m, 0, sizeof(*m));
+  m->width = width;
+  for (int v = 0; v < MIXER_VOICES; v++) m->voices[v].sound = -1;
+}
+
+// Retorna o id do som, -1 se nao couber
+int MixerAddSound(Mixer* m, const float* samples, int frames, int polyphony, float volume) {
+  if (m->num_sounds >= MIXER_SOUNDS) return -1;
+  m->sounds[m->num_sounds] = (MixerSound) { samples, samples ? frames : 0, polyphony < 1 ? 1 : polyphony, volume };
+  return m->num_sounds++;
+}
+
+// So anota o pedido; varios do mesmo som antes do flush tocam juntos no x medio
+void MixerPlay(Mixer* m, int sound, float x) {
+  if (sound < 0 || sound >= m->num_sounds || !m->sounds[sound].frames) return;
+  PendingSound* p = &m->pending[sound];
+  p->count++;
+  p->x += x;
+  m->requested++;
+}
+
+// Chamado uma vez por tick: cada som pedido ganha uma voz, mais alta quanto mais pedidos juntou
+void MixerFlush(Mixer* m) {
+  for (int s = 0; s < m->num_sounds; s++) {
+    PendingSound* p = &m->pending[s];
+    if (!p->count) continue;
+    float gain = 1 + MIXER_MERGE_GAIN * (p->count - 1);
+    StartVoice(m, s, p->x / p->count, gain < MIXER_MERGE_GAIN_MAX ? gain : MIXER_MERGE_GAIN_MAX);
+    m->merged += p->count - 1;
+    *p = (PendingSound) { 0 };
+  }
+}
+
+// Mixa em blocos e intercala em estereo, saturando em [-1, 1]
+void MixerRender(Mixer* m, float* out, int frames) {
+  for (int done = 0, n; done < frames; done += n) {
+    n = frames - done < MIXER_BLOCK ? frames - done : MIXER_BLOCK;
+    memset(m->left,  0, n * sizeof(float));
+    memset(m->right, 0, n * sizeof(float));
+
+    for (int v = 0; v < MIXER_VOICES; v++) {
+      Voice* voice = &m->voices[v];
+      if (voice->sound < 0) continue;
+      MixerSound* s = &m->sounds[voice->sound];
+      int len = s->frames - voice->pos < n ? s->frames - voice->pos : n;
+      MixVoice(m->left, m->right, s->samples + voice->pos, len, voice->left, voice->right);
+      voice->pos += len;
+      if (voice->pos >= s->frames) {
+        m->playing[voice->sound]--;
+        voice->sound = -1;
+      }
+    }
+
+    float* dst = out + done * 2;
+    for (int i = 0; i < n; i++) {
+      float l = m->left[i], r = m->right[i];
+      dst[i * 2]     = l > 1 ? 1 : l < -1 ? -1 : l;
+      dst[i * 2 + 1] = r > 1 ? 1 : r < -1 ? -1 : r;
+    }
+  }
+}
+
+int MixerActiveVoices(Mixer* m) {
+  int active = 0;
+  for (int v = 0; v < MIXER_VOICES; v++) active += m->voices[v].sound >= 0;
+  return active;
+}
+
+// ---
+
+// Voz pro som: a mais velha dele se ja esta no limite, senao uma livre, senao a mais velha de todas
+static int StealVoice(Mixer* m, int sound) {
+  int full = m->playing[sound] >= m->sounds[sound].polyphony;
+  int best = -1;
+  for (int v = 0; v < MIXER_VOICES; v++) {
+    Voice* voice = &m->voices[v];
+    if (full && voice->sound != sound) continue;
+    if (!full && voice->sound < 0) return v;
+    if (best < 0 || voice->started < m->voices[best].started) best = v;
+  }
+  return best;
+}
+
+static void StartVoice(Mixer* m, int sound, float x, float gain) {
+  int v = StealVoice(m, sound);
+  Voice* voice = &m->voices[v];
+  if (voice->sound >= 0) {
+    m->playing[voice->sound]--;
+    m->stolen++;
+  }
+
+  // Pan de potencia constante com o centro em ganho 1 nos dois lados
+  float pan = m->width > 0 ? x / m->width : 0.5f;
+  pan = pan < 0 ? 0 : pan > 1 ? 1 : pan;
+  float left  = cosf(pan * 1.5707963f) * 1.4142136f;
+  float right = sinf(pan * 1.5707963f) * 1.4142136f;
+  float volume = m->sounds[sound].volume * gain;
+
+  *voice = (Voice) { sound, 0, (left < 1 ? left : 1) * volume, (right < 1 ? right : 1) * volume, m->started++ };
+  m->playing[sound]++;
+}
+
+// Laco reto sem dependencia entre iteracoes, o compilador vetoriza
+static void MixVoice(float* restrict left, float* restrict right, const float* restrict src, int n, float gl, float gr) {
+  for (int i = 0; i < n; i++) {
+    left[i]  += src[i] * gl;
+    right[i] += src[i] * gr;
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+// Mixer de efeitos em software: pool fixo de vozes, limite de vozes por som e pan pela posicao x
+// Pedidos iguais no mesmo tick viram uma voz so; o custo de mixar depende so do numero de vozes
+// Sem raylib, a apresentacao entrega as amostras e manda o resultado pra um AudioStream
+
+#include <stdint.h>
+
+#define MIXER_RATE   44100
+#define MIXER_VOICES 32
+#define MIXER_SOUNDS 32
+#define MIXER_BLOCK  256 // Frames mixados por passada, cabe na L1 junto com as amostras
+
+#define MIXER_MERGE_GAIN     0.25f // Ganho extra por pedido juntado
+#define MIXER_MERGE_GAIN_MAX 2.0f
+
+// Amostras mono em float na MIXER_RATE; o mixer so guarda o ponteiro
+typedef struct {
+  const float* samples;
+  int frames;
+  int polyphony; // Vozes tocando esse som ao mesmo tempo, a mais velha e cortada
+  float volume;
+} MixerSound;
+
+typedef struct {
+  int sound; // -1 = livre
+  int pos;
+  float left, right;
+  uint32_t started; // Ordem de inicio, pra achar a mais velha
+} Voice;
+
+// Pedidos acumulados desde o ultimo MixerFlush, um por som
+typedef struct {
+  int count;
+  float x;
+} PendingSound;
+
+typedef struct {
+  MixerSound sounds[MIXER_SOUNDS];
+  int num_sounds;
+  Voice voices[MIXER_VOICES];
+  int playing[MIXER_SOUNDS]; // Vozes ativas por som
+  PendingSound pending[MIXER_SOUNDS];
+  float width; // Largura da tela, x = 0 toca so na esquerda e x = width so na direita
+  uint32_t started;
+  float left[MIXER_BLOCK], right[MIXER_BLOCK];
+
+  // Contadores desde o MixerInit
+  long requested, merged, stolen;
+} Mixer;
+
+void MixerInit(Mixer* m, float width);
+int  MixerAddSound(Mixer* m, const float* samples, int frames, int polyphony, float volume);
+void MixerPlay(Mixer* m, int sound, float x);
+void MixerFlush(Mixer* m);
+void MixerRender(Mixer* m, float* out, int frames);
+int  MixerActiveVoices(Mixer* m);
+
+#endif
@@ -0,0 +1,286 @@
+#include "net.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#define INPUT_MASK   (NET_INPUTS - 1)
+#define HOST_KEYS    (IN_LEFT | IN_RIGHT | IN_SHOOT | IN_WIN | IN_LOSE) // Atalhos F2/F3 so valem no host
+#define PARTNER_KEYS (IN_LEFT | IN_RIGHT | IN_SHOOT)
+
+static void     Receive(NetSession* s);
+static void     Send(NetSession* s);
+static void     Flush(NetSession* s);
+static void     Step(NetSession* s, int64_t t);
+static void     Rollback(NetSession* s);
+static void     Confirm(NetSession* s);
+static void     Save(NetSession* s, int64_t t);
+static void     Load(NetSession* s, int64_t t);
+static float    Random01(NetSession* s);
+static uint64_t Mix(uint64_t h, const void* data, size_t n);
+static uint64_t MixShip(uint64_t h, Ship* ship);
+
+// Sem peer e o host e escuta na porta; com peer ("ip:porta") entra no jogo dele
+// A semente e o modo so valem no host, quem entra recebe os dele
+int NetOpen(NetSession* s, int port, const char* peer, uint64_t seed, int mode) {
+  memset(s, 0, sizeof(*s));
+  s->clock = (Clock) { MonotonicNs };
+  s->side = peer != NULL;
+  s->seed = seed;
+  s->mode = mode;
+  s->rng = seed ^ 0x9E3779B97F4A7C15ULL ^ s->side;
+  s->remote_tick = s->rollback_to = s->confirmed = -1;
+
+  if (peer) {
+    char host[256];
+    int peer_port;
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_DGRAM }, * info;
+    if (sscanf(peer, "%255[^:]:%d", host, &peer_port) != 2 || getaddrinfo(host, NULL, &hints, &info)) return 0;
+    s->peer = *(struct sockaddr_in*) info->ai_addr;
+    s->peer.sin_port = htons(peer_port);
+    s->has_peer = 1;
+    freeaddrinfo(info);
+  }
+
+  s->fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in local = { .sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY) };
+  if (s->fd < 0 || bind(s->fd, (struct sockaddr*) &local, sizeof(local)) || fcntl(s->fd, F_SETFL, O_NONBLOCK)) {
+    NetClose(s);
+    return 0;
+  }
+
+  for (int i = 0; i < NET_STATES; i++) {
+    if ((s->states[i].arena = malloc(SIM_ARENA_SIZE))) continue;
+    NetClose(s);
+    return 0;
+  }
+  return 1;
+}
+
+void NetClose(NetSession* s) {
+  if (s->fd > 0) close(s->fd);
+  for (int i = 0; i < NET_STATES; i++) free(s->states[i].arena);
+  s->fd = -1;
+}
+
+// Antes do NetStart: troca pacotes vazios ate os dois lados se acharem; retorna 1 quando pode comecar
+int NetPoll(NetSession* s) {
+  Receive(s);
+  Flush(s);
+  Send(s);
+  return s->ready;
+}
+
+// g ja passou pelo SimInit; os dois lados comecam do mesmo estado
+void NetStart(NetSession* s, Game* g) {
+  s->g = g;
+  g->rng = s->seed ? s->seed : 1;
+  g->mode = s->mode;
+  g->coop = 1;
+  SimNewRun(g);
+  SimStartRound(g);
+  s->tick = 0;
+}
+
+// Um tick com a entrada local; retorna 0 se ficou esperando o outro lado, ai nada andou
+int NetAdvance(NetSession* s, Input local) {
+  Receive(s);
+  Flush(s);
+  s->stats.last_resim_ns = 0;
+  if (s->rollback_to >= 0) Rollback(s);
+  Confirm(s);
+
+  if (s->tick - s->remote_tick > NET_WINDOW) {
+    s->stats.stalls++;
+    Send(s);
+    return 0;
+  }
+
+  s->local[s->tick & INPUT_MASK] = local & (s->side ? PARTNER_KEYS : HOST_KEYS);
+  Step(s, s->tick++);
+  Send(s);
+  return 1;
+}
+
+// Um tick do coop; o fim do round vira uma pausa dentro da simulacao, pros dois lados trocarem de round no mesmo tick
+void NetSimStep(Game* g, Input input) {
+  if (!g->over) {
+    SimTick(g, input);
+    return;
+  }
+  g->num_events = 0;
+  if (++g->tick - g->over_tick < NET_ROUND_DELAY) return;
+  if (!g->winner) SimNewRun(g);
+  SimStartRound(g);
+}
+
+// Hash so do que a simulacao usa, sem ponteiros, pra comparar os dois lados
+uint64_t NetChecksum(Game* g) {
+  uint64_t h = 14695981039346656037ULL;
+  Bullets* b = &g->bullets;
+  Formation* f = &g->enemies;
+  h = Mix(h, &g->tick, sizeof(g->tick));
+  h = Mix(h, &g->rng, sizeof(g->rng));
+  h = Mix(h, &g->pts, sizeof(g->pts));
+  h = Mix(h, &g->level, sizeof(g->level));
+  h = Mix(h, &g->over, sizeof(g->over));
+  h = Mix(h, &g->winner, sizeof(g->winner));
+  h = Mix(h, &g->enemy_direction, sizeof(g->enemy_direction));
+  h = Mix(h, &g->player_immune, sizeof(g->player_immune));
+  h = Mix(h, &g->partner_immune, sizeof(g->partner_immune));
+  h = MixShip(h, &g->player);
+  h = MixShip(h, &g->partner);
+  h = Mix(h, &g->barriers, sizeof(g->barriers));
+  h = Mix(h, &b->count, sizeof(b->count));
+  h = Mix(h, b->x, b->count * sizeof(float));
+  h = Mix(h, b->y, b->count * sizeof(float));
+  h = Mix(h, b->vy, b->count * sizeof(float));
+  h = Mix(h, b->owner, b->count);
+  h = Mix(h, &f->count, sizeof(f->count));
+  h = Mix(h, f->x, f->count * sizeof(float));
+  h = Mix(h, f->y, f->count * sizeof(float));
+  return Mix(h, f->alive, f->count);
+}
+
+// ---
+
+// Guarda as entradas novas do outro lado, que chegam em ordem gracas a redundancia
+// Uma entrada diferente da prevista num tick ja simulado marca o rollback
+static void Receive(NetSession* s) {
+  NetPacket p;
+  struct sockaddr_in from;
+  socklen_t len = sizeof(from);
+  for (; recvfrom(s->fd, &p, sizeof(p), 0, (struct sockaddr*) &from, &len) == sizeof(p); len = sizeof(from)) {
+    if (p.magic != NET_MAGIC || p.count < 0 || p.count > NET_REDUNDANCY) continue;
+    if (!s->has_peer && !s->side) {
+      s->peer = from;
+      s->has_peer = 1;
+    }
+    if (from.sin_addr.s_addr != s->peer.sin_addr.s_addr || from.sin_port != s->peer.sin_port) continue;
+    if (s->side && !s->g) {
+      s->seed = p.seed;
+      s->mode = MIN(HARDCORE, MAX(NORMAL, p.mode)); // Indexa as tabelas de dificuldade, nao confia no pacote
+    }
+    s->ready = 1;
+    s->stats.received++;
+
+    for (int i = 0; i < p.count; i++) {
+      int64_t u = (int64_t) p.tick - p.count + 1 + i;
+      if (u <= s->remote_tick) continue;
+      if (u != s->remote_tick + 1) break; // Buraco, os proximos pacotes repetem essas entradas
+      Input input = p.inputs[i];
+      s->remote[u & INPUT_MASK] = input;
+      s->remote_tick = u;
+      if (u < s->tick && s->used[u & INPUT_MASK] != input && (s->rollback_to < 0 || u < s->rollback_to)) s->rollback_to = u;
+    }
+  }
+}
+
+// Manda as ultimas entradas locais; a perda e a latencia artificiais entram aqui
+static void Send(NetSession* s) {
+  if (!s->has_peer) return;
+  NetPacket p = { NET_MAGIC, s->mode, s->seed, s->tick - 1, MIN(NET_REDUNDANCY, s->tick) };
+  for (int i = 0; i < p.count; i++) p.inputs[i] = s->local[(p.tick - p.count + 1 + i) & INPUT_MASK];
+
+  s->stats.sent++;
+  if (s->loss > 0 && Random01(s) < s->loss) {
+    s->stats.lost++;
+    return;
+  }
+  uint64_t delay = (s->latency_ms + (s->jitter_ms ? Random01(s) * s->jitter_ms : 0)) * 1000000ULL;
+  if (!delay || s->outbox_count == NET_OUTBOX) {
+    sendto(s->fd, &p, sizeof(p), 0, (struct sockaddr*) &s->peer, sizeof(s->peer));
+    return;
+  }
+  s->outbox[s->outbox_count++] = (NetDelayed) { p, ClockNow(&s->clock) + delay };
+}
+
+// Solta os pacotes atrasados que ja deram a hora, mantendo a ordem dos outros
+static void Flush(NetSession* s) {
+  uint64_t now = ClockNow(&s->clock);
+  int kept = 0;
+  for (int i = 0; i < s->outbox_count; i++) {
+    NetDelayed* d = &s->outbox[i];
+    if (d->at <= now) sendto(s->fd, &d->packet, sizeof(d->packet), 0, (struct sockaddr*) &s->peer, sizeof(s->peer));
+    else s->outbox[kept++] = *d;
+  }
+  s->outbox_count = kept;
+}
+
+// Salva o estado antes do tick e simula com a entrada do outro lado, recebida ou prevista
+static void Step(NetSession* s, int64_t t) {
+  Save(s, t);
+  Input remote = t <= s->remote_tick ? s->remote[t & INPUT_MASK] : s->remote_tick >= 0 ? s->remote[s->remote_tick & INPUT_MASK] : 0;
+  Input mine = s->local[t & INPUT_MASK];
+  s->used[t & INPUT_MASK] = remote;
+  Input host = s->side ? remote : mine, partner = s->side ? mine : remote;
+  NetSimStep(s->g, (host & HOST_KEYS) | (partner & PARTNER_KEYS) << PARTNER_SHIFT);
+}
+
+// Volta pro tick errado e re-simula ate o atual; os eventos que sobram sao so os do ultimo tick
+static void Rollback(NetSession* s) {
+  uint64_t start = MonotonicNs(NULL);
+  int depth = s->tick - s->rollback_to;
+  Load(s, s->rollback_to);
+  for (int64_t t = s->rollback_to; t < s->tick; t++) Step(s, t);
+  s->rollback_to = -1;
+
+  uint64_t ns = MonotonicNs(NULL) - start;
+  s->stats.rollbacks++;
+  s->stats.resim_ticks += depth;
+  s->stats.max_rollback = MAX(s->stats.max_rollback, depth);
+  s->stats.resim_ns += ns;
+  s->stats.last_resim_ns = ns;
+  s->stats.max_resim_ns = MAX(s->stats.max_resim_ns, ns);
+}
+
+// O estado depois do tick u e final quando a entrada do outro lado nele ja chegou e ele ja foi salvo (antes do u + 1)
+static void Confirm(NetSession* s) {
+  int64_t last = MIN(s->remote_tick, s->tick - 2);
+  while (s->confirmed < last) {
+    s->confirmed++;
+    if (!s->verify_until || s->confirmed < s->verify_until) {
+      uint64_t sum = s->states[(s->confirmed + 1) % NET_STATES].checksum;
+      s->history = Mix(s->history, &sum, sizeof(sum));
+    }
+  }
+}
+
+// A arena fica no mesmo endereco, entao copiar os bytes de volta mantem os ponteiros da formacao validos
+static void Save(NetSession* s, int64_t t) {
+  NetState* state = &s->states[t % NET_STATES];
+  state->game = *s->g;
+  memcpy(state->arena, s->g->arena.base, s->g->arena.used);
+  state->checksum = NetChecksum(s->g);
+}
+
+static void Load(NetSession* s, int64_t t) {
+  NetState* state = &s->states[t % NET_STATES];
+  *s->g = state->game;
+  memcpy(s->g->arena.base, state->arena, state->game.arena.used);
+}
+
+static float Random01(NetSession* s) {
+  s->rng = s->rng * 6364136223846793005ULL + 1442695040888963407ULL;
+  return (s->rng >> 40) / (float) (1 << 24);
+}
+
+// FNV-1a
+// Campo por campo: o Ship tem padding antes do next_shoot, que nao e igual entre os dois lados
+static uint64_t MixShip(uint64_t h, Ship* ship) {
+  h = Mix(h, &ship->pos, sizeof(ship->pos));
+  h = Mix(h, &ship->hp, sizeof(ship->hp));
+  h = Mix(h, &ship->shooting, sizeof(ship->shooting));
+  h = Mix(h, &ship->dx, sizeof(ship->dx));
+  return Mix(h, &ship->next_shoot, sizeof(ship->next_shoot));
+}
+
+static uint64_t Mix(uint64_t h, const void* data, size_t n) {
+  const uint8_t* p = data;
+  for (size_t i = 0; i < n; i++) h = (h ^ p[i]) * 1099511628211ULL;
+  return h;
+}
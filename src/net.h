@@ -0,0 +1,85 @@
+#ifndef NET_H
+#define NET_H
+
+// Dois jogadores em coop por UDP com rollback
+// Cada lado simula na hora com a entrada do outro prevista (a ultima recebida); quando a de verdade chega diferente,
+// volta pro estado salvo do tick errado e re-simula ate o atual
+// Latencia e perda artificiais no envio, pra testar no loopback; o relogio pode ser falso pra rodar mais rapido que 60 Hz
+
+#include "sim.h"
+#include <netinet/in.h>
+
+#define NET_WINDOW      8  // Ticks maximos na frente da ultima entrada recebida; passou disso, espera
+#define NET_STATES      (NET_WINDOW + 2)
+#define NET_REDUNDANCY  16 // Entradas repetidas em cada pacote, cobre pacote perdido sem reenvio
+#define NET_INPUTS      64 // Anel de entradas, potencia de 2
+#define NET_OUTBOX      512
+#define NET_ROUND_DELAY (TICK_RATE * 2) // Ticks entre o fim de um round e o proximo, sem menu no meio
+#define NET_MAGIC       0x4E524953      // "SIRN"
+
+// Mesmo binario dos dois lados, vai cru na rede
+typedef struct {
+  uint32_t magic;
+  int32_t mode;    // O modo e a semente sao sempre os do host
+  uint64_t seed;
+  int32_t tick;    // Tick da ultima entrada do pacote
+  int32_t count;
+  uint8_t inputs[NET_REDUNDANCY]; // inputs[i] e do tick - count + 1 + i
+} NetPacket;
+
+typedef struct {
+  NetPacket packet;
+  uint64_t at; // Quando sai de verdade
+} NetDelayed;
+
+// Estado inteiro antes de um tick: o jogo e os bytes usados da arena
+typedef struct {
+  Game game;
+  uint8_t* arena;
+  uint64_t checksum;
+} NetState;
+
+typedef struct {
+  long rollbacks, resim_ticks, stalls;
+  long sent, received, lost;
+  int max_rollback;
+  uint64_t resim_ns, max_resim_ns, last_resim_ns; // last = do ultimo NetAdvance
+} NetStats;
+
+typedef struct {
+  int fd, side; // side 0 e o host, que joga com o player; 1 joga com o partner
+  struct sockaddr_in peer;
+  int has_peer, ready;
+  uint64_t seed;
+  int mode;
+
+  Clock clock;
+  int latency_ms, jitter_ms;
+  float loss;
+  uint64_t rng; // So pra latencia e perda, separado da simulacao
+  NetDelayed outbox[NET_OUTBOX];
+  int outbox_count;
+
+  Game* g;
+  NetState states[NET_STATES];
+  Input local[NET_INPUTS], remote[NET_INPUTS], used[NET_INPUTS]; // used = entrada do outro usada no tick
+  int64_t tick;        // Proximo tick a simular
+  int64_t remote_tick; // Ultimo tick com a entrada do outro lado, -1 se nenhum
+  int64_t rollback_to; // Primeiro tick previsto errado, -1 se nenhum
+
+  // Ticks finais (entradas dos dois lados conhecidas) vao entrando num hash so, pra comparar os lados
+  int64_t confirmed, verify_until;
+  uint64_t history;
+
+  NetStats stats;
+} NetSession;
+
+int  NetOpen(NetSession* s, int port, const char* peer, uint64_t seed, int mode);
+void NetClose(NetSession* s);
+int  NetPoll(NetSession* s);
+void NetStart(NetSession* s, Game* g);
+int  NetAdvance(NetSession* s, Input local);
+void NetSimStep(Game* g, Input input);
+uint64_t NetChecksum(Game* g);
+
+#endif
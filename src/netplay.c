@@ -0,0 +1,114 @@
+// Dois lados do coop no mesmo processo, pelo loopback, com latencia e perda artificiais
+// O relogio e falso e anda 1/60 s por volta, entao roda bem mais rapido que o jogo mas com os mesmos atrasos
+// No fim compara o hash dos ticks confirmados dos dois lados; diferente = dessincronizou
+// Uso: ./netplay [--ticks N] [--latency MS] [--jitter MS] [--loss 0-1] [--seed S] [--mode 0-2]
+//                [--policy idle|random|track] [--port P]
+
+#include "net.h"
+#include "policy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_DRAIN (TICK_RATE * 10) // Voltas extras pros dois lados confirmarem os ultimos ticks
+
+uint64_t VirtualNs(void* ctx) {
+  return *(uint64_t*) ctx;
+}
+
+// O partner joga com a mesma politica, vendo o jogo como se a nave dele fosse o player
+Input PartnerInput(Game* g, Policy policy, PolicyState* state) {
+  static Game view;
+  view = *g;
+  view.player = g->partner;
+  return policy(&view, state);
+}
+
+void PrintStats(const char* name, NetSession* s) {
+  NetStats* st = &s->stats;
+  printf("%s ticks %ld confirmed %ld rollbacks %ld resim_ticks %ld max_rollback %d stalls %ld\n",
+         name, (long) s->tick, (long) s->confirmed, st->rollbacks, st->resim_ticks, st->max_rollback, st->stalls);
+  printf("%s packets sent %ld received %ld lost %ld resim %.1fus/rollback max %.1fus\n",
+         name, st->sent, st->received, st->lost,
+         st->rollbacks ? st->resim_ns / 1e3 / st->rollbacks : 0, st->max_resim_ns / 1e3);
+}
+
+int main(int argc, char** argv) {
+  int ticks = TICK_RATE * 60, latency = 50, jitter = 20, mode = NORMAL, port = 47000;
+  float loss = 0.05;
+  uint64_t seed = 1;
+  Policy policy = PolicyTrack;
+
+  for (int i = 1; i < argc - 1; i++) {
+    if      (!strcmp(argv[i], "--ticks"))   ticks   = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--latency")) latency = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--jitter"))  jitter  = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--loss"))    loss    = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--seed"))    seed    = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--mode"))    mode    = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--port"))    port    = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--policy"))  policy  = PolicyByName(argv[++i]);
+  }
+
+  mode = MIN(HARDCORE, MAX(NORMAL, mode)); // Indexa as tabelas de dificuldade e vai pro outro lado assim
+  static NetSession host, client;
+  char address[32];
+  snprintf(address, sizeof(address), "127.0.0.1:%d", port);
+  if (!NetOpen(&host, port, NULL, seed, mode) || !NetOpen(&client, 0, address, 0, 0)) {
+    fprintf(stderr, "Could not open UDP port %d\n", port);
+    return 1;
+  }
+
+  uint64_t now = 0;
+  NetSession* sides[2] = { &host, &client };
+  for (int i = 0; i < 2; i++) {
+    sides[i]->clock = (Clock) { VirtualNs, &now };
+    sides[i]->latency_ms = latency;
+    sides[i]->jitter_ms = jitter;
+    sides[i]->loss = loss;
+    sides[i]->verify_until = ticks;
+  }
+
+  // Handshake, pelo mesmo caminho com atraso e perda
+  int waited = 0;
+  while (!(NetPoll(&host) & NetPoll(&client))) {
+    now += 1000000000ULL / TICK_RATE;
+    if (++waited > MAX_DRAIN) {
+      fprintf(stderr, "No handshake\n");
+      return 1;
+    }
+  }
+
+  Game games[2];
+  if (!SimInit(&games[0], 1) || !SimInit(&games[1], 1)) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  NetStart(&host, &games[0]);
+  NetStart(&client, &games[1]);
+
+  // Depois do ultimo tick verificado os dois continuam sem apertar nada, so pra receber as entradas que faltam
+  PolicyState states[2] = { { seed, 0 }, { seed + 1, 0 } };
+  int drain = 0;
+  while (host.confirmed < ticks - 1 || client.confirmed < ticks - 1) {
+    now += 1000000000ULL / TICK_RATE;
+    int done = host.tick >= ticks && client.tick >= ticks;
+    if (done && ++drain > MAX_DRAIN) break;
+    NetAdvance(&host,   done ? 0 : policy(host.g, &states[0]));
+    NetAdvance(&client, done ? 0 : PartnerInput(client.g, policy, &states[1]));
+  }
+
+  PrintStats("host", &host);
+  PrintStats("client", &client);
+  printf("level %d pts %d\n", games[0].level, games[0].pts);
+
+  int ok = host.confirmed >= ticks - 1 && client.confirmed >= ticks - 1 && host.history == client.history;
+  printf("history %016llx %016llx\n", (unsigned long long) host.history, (unsigned long long) client.history);
+  printf("%s\n", ok ? "OK" : host.history == client.history ? "UNCONFIRMED" : "DESYNC");
+
+  NetClose(&host);
+  NetClose(&client);
+  SimFree(&games[0]);
+  SimFree(&games[1]);
+  return ok ? 0 : 2;
+}
@@ -0,0 +1,63 @@
+#include "pack.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Mapeia o arquivo inteiro; retorna 0 se faltar ou estiver corrompido
+int PackOpen(Pack* pack, const char* path) {
+  *pack = (Pack) { 0 };
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return 0;
+
+  struct stat st;
+  if (fstat(fd, &st) || st.st_size < sizeof(PackHeader)) {
+    close(fd);
+    return 0;
+  }
+
+  void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return 0;
+
+  const PackHeader* header = data;
+  pack->data = data;
+  pack->size = st.st_size;
+  if (header->magic != PACK_MAGIC || header->version != PACK_VERSION ||
+      sizeof(PackHeader) + (size_t) header->count * sizeof(PackEntry) > pack->size) {
+    PackClose(pack);
+    return 0;
+  }
+
+  pack->entries = (const PackEntry*) (pack->data + sizeof(PackHeader));
+  pack->count = header->count;
+  for (uint32_t i = 0; i < pack->count; i++) {
+    if (pack->entries[i].offset + pack->entries[i].size > pack->size) {
+      PackClose(pack);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+void PackClose(Pack* pack) {
+  if (pack->data) munmap((void*) pack->data, pack->size);
+  *pack = (Pack) { 0 };
+}
+
+// Os nomes vem ordenados do empacotador, entao da pra fazer busca binaria
+const uint8_t* PackFind(Pack* pack, const char* name, int* size) {
+  int lo = 0, hi = (int) pack->count - 1;
+  while (lo <= hi) {
+    int mid = (lo + hi) / 2;
+    int cmp = strncmp(name, pack->entries[mid].name, PACK_NAME);
+    if (!cmp) {
+      if (size) *size = pack->entries[mid].size;
+      return pack->data + pack->entries[mid].offset;
+    }
+    if (cmp < 0) hi = mid - 1;
+    else lo = mid + 1;
+  }
+  return NULL;
+}
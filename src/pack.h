@@ -0,0 +1,35 @@
+#ifndef PACK_H
+#define PACK_H
+
+// Arquivo unico com todos os assets, lido via mmap
+// Layout: PackHeader, PackEntry[count], dados alinhados em PACK_ALIGN
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define PACK_MAGIC   0x4b504953 // "SIPK"
+#define PACK_VERSION 1
+#define PACK_NAME    48
+#define PACK_ALIGN   16
+
+typedef struct {
+  uint32_t magic, version, count, reserved;
+} PackHeader;
+
+typedef struct {
+  char name[PACK_NAME];
+  uint64_t offset, size;
+} PackEntry;
+
+typedef struct {
+  const uint8_t* data;
+  size_t size;
+  const PackEntry* entries;
+  uint32_t count;
+} Pack;
+
+int  PackOpen(Pack* pack, const char* path);
+void PackClose(Pack* pack);
+const uint8_t* PackFind(Pack* pack, const char* name, int* size);
+
+#endif
@@ -0,0 +1,103 @@
+// Empacota uma pasta de assets num arquivo so pro jogo mapear na memoria
+// Uso: ./packer assets assets.pak
+
+#include "pack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define MAX_FILES 256
+
+int CompareNames(const void* a, const void* b) {
+  return strcmp(((PackEntry*) a)->name, ((PackEntry*) b)->name);
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <dir> <out.pak>\n", argv[0]);
+    return 1;
+  }
+
+  DIR* dir = opendir(argv[1]);
+  if (!dir) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  static PackEntry entries[MAX_FILES];
+  uint32_t count = 0;
+  char path[1024];
+  for (struct dirent* d; (d = readdir(dir));) {
+    struct stat st;
+    // Caminho que nao cabe em path e pulado junto com os nomes longos, entao o segundo laco sempre cabe
+    int length = snprintf(path, sizeof(path), "%s/%s", argv[1], d->d_name);
+    if (length >= sizeof(path) || stat(path, &st) || !S_ISREG(st.st_mode)) continue;
+    if (strlen(d->d_name) >= PACK_NAME || count == MAX_FILES) {
+      fprintf(stderr, "skipping %s\n", d->d_name);
+      continue;
+    }
+    strcpy(entries[count].name, d->d_name);
+    entries[count++].size = st.st_size;
+  }
+  closedir(dir);
+
+  // Ordenado pro leitor fazer busca binaria
+  qsort(entries, count, sizeof(PackEntry), CompareNames);
+
+  uint64_t offset = sizeof(PackHeader) + count * sizeof(PackEntry);
+  for (uint32_t i = 0; i < count; i++) {
+    offset = (offset + PACK_ALIGN - 1) / PACK_ALIGN * PACK_ALIGN;
+    entries[i].offset = offset;
+    offset += entries[i].size;
+  }
+
+  // Escreve num temporario e renomeia, pra nunca deixar um pacote pela metade
+  // Qualquer erro apaga o temporario, entao um disco cheio nunca deixa um pacote cortado no lugar do antigo
+  char tmp[1024];
+  if (snprintf(tmp, sizeof(tmp), "%s.tmp", argv[2]) >= sizeof(tmp)) {
+    fprintf(stderr, "%s: path too long\n", argv[2]);
+    return 1;
+  }
+  FILE* out = fopen(tmp, "wb");
+  if (!out) {
+    perror(tmp);
+    return 1;
+  }
+
+  PackHeader header = { PACK_MAGIC, PACK_VERSION, count, 0 };
+  int ok = fwrite(&header, sizeof(header), 1, out) == 1 && fwrite(entries, sizeof(PackEntry), count, out) == count;
+
+  for (uint32_t i = 0; ok && i < count; i++) {
+    while (ftell(out) < entries[i].offset) fputc(0, out);
+    if (snprintf(path, sizeof(path), "%s/%s", argv[1], entries[i].name) >= sizeof(path)) { // Ja conferido no primeiro laco
+      fprintf(stderr, "%s: path too long\n", entries[i].name);
+      fclose(out);
+      remove(tmp);
+      return 1;
+    }
+    FILE* in = fopen(path, "rb");
+    char* data = malloc(entries[i].size);
+    if (!in || !data || fread(data, 1, entries[i].size, in) != entries[i].size) {
+      perror(path);
+      fclose(out);
+      remove(tmp);
+      return 1;
+    }
+    ok = fwrite(data, 1, entries[i].size, out) == entries[i].size;
+    free(data);
+    fclose(in);
+  }
+
+  // O fclose sozinho nao garante avisar de um fwrite que ja falhou, o ferror sim
+  ok = !ferror(out) && ok;
+  ok = !fclose(out) && ok;
+  if (!ok || rename(tmp, argv[2])) {
+    perror(argv[2]);
+    remove(tmp);
+    return 1;
+  }
+  printf("packed %u files, %lu bytes into %s\n", count, (unsigned long) offset, argv[2]);
+  return 0;
+}
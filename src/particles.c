@@ -0,0 +1,104 @@
+#include "particles.h"
+#include <math.h>
+
+#define INFINITE_LIFE 1e30f
+
+static float Random01(Particles* p);
+
+void ParticlesInit(Particles* p, uint64_t seed) {
+  p->count = 0;
+  p->rng = seed ? seed : 1;
+}
+
+void ParticlesClear(Particles* p) {
+  p->count = 0;
+}
+
+// Explosao: n particulas saindo do mesmo ponto em direcoes aleatorias
+// Emite em bloco contiguo no fim do pool; retorna quantas couberam
+int ParticlesBurst(Particles* p, int n, float x, float y, float speed, float life, float size, uint32_t color) {
+  int start = p->count;
+  n = start + n > MAX_PARTICLES ? MAX_PARTICLES - start : n;
+
+  for (int i = start; i < start + n; i++) {
+    float angle = Random01(p) * 6.2831853f;
+    float v = speed * (0.3f + 0.7f * Random01(p));
+    p->vx[i] = cosf(angle) * v;
+    p->vy[i] = sinf(angle) * v;
+    p->life[i] = life * (0.5f + 0.5f * Random01(p));
+  }
+  for (int i = start; i < start + n; i++) {
+    p->x[i] = x;
+    p->y[i] = y;
+    p->fade[i] = 1 / p->life[i];
+    p->size[i] = size;
+    p->color[i] = color;
+  }
+
+  p->count += n;
+  return n;
+}
+
+// Campo espalhado pela tela que nunca morre, usado nas camadas de estrelas
+int ParticlesField(Particles* p, int n, float w, float h, float vy, float size, uint32_t color) {
+  int start = p->count;
+  n = start + n > MAX_PARTICLES ? MAX_PARTICLES - start : n;
+
+  for (int i = start; i < start + n; i++) {
+    p->x[i] = Random01(p) * w;
+    p->y[i] = Random01(p) * h;
+  }
+  for (int i = start; i < start + n; i++) {
+    p->vx[i] = 0;
+    p->vy[i] = vy;
+    p->life[i] = INFINITE_LIFE;
+    p->fade[i] = 0;
+    p->size[i] = size;
+    p->color[i] = color;
+  }
+
+  p->count += n;
+  return n;
+}
+
+// Integra posicao e vida; dt em ticks de 1/60s
+void ParticlesUpdate(Particles* p, float dt, float gravity) {
+  int n = p->count;
+  for (int i = 0; i < n; i++) p->vy[i] += gravity * dt;
+  for (int i = 0; i < n; i++) p->x[i] += p->vx[i] * dt;
+  for (int i = 0; i < n; i++) p->y[i] += p->vy[i] * dt;
+  for (int i = 0; i < n; i++) p->life[i] -= dt;
+}
+
+// Quem passa do fundo volta pro topo
+void ParticlesWrap(Particles* p, float top, float bottom) {
+  int n = p->count;
+  for (int i = 0; i < n; i++) p->y[i] = p->y[i] > bottom ? top : p->y[i];
+}
+
+// Remove as mortas trazendo as do fim pro lugar delas
+void ParticlesReap(Particles* p) {
+  for (int i = 0; i < p->count;) {
+    if (p->life[i] > 0) {
+      i++;
+      continue;
+    }
+    int last = --p->count;
+    p->x[i] = p->x[last];
+    p->y[i] = p->y[last];
+    p->vx[i] = p->vx[last];
+    p->vy[i] = p->vy[last];
+    p->life[i] = p->life[last];
+    p->fade[i] = p->fade[last];
+    p->size[i] = p->size[last];
+    p->color[i] = p->color[last];
+  }
+}
+
+// xorshift64*, devolve um float em [0, 1)
+static float Random01(Particles* p) {
+  p->rng ^= p->rng >> 12;
+  p->rng ^= p->rng << 25;
+  p->rng ^= p->rng >> 27;
+  return ((p->rng * 0x2545F4914F6CDD1DULL) >> 40) / 16777216.0f;
+}
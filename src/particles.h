@@ -0,0 +1,29 @@
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+// Particulas em struct-of-arrays com capacidade fixa
+// Atualizacao em passadas retas pra vetorizar; sem raylib, a apresentacao desenha
+
+#include <stdint.h>
+
+#define MAX_PARTICLES (1 << 17)
+
+typedef struct {
+  int count;
+  float x[MAX_PARTICLES], y[MAX_PARTICLES];
+  float vx[MAX_PARTICLES], vy[MAX_PARTICLES];
+  float life[MAX_PARTICLES], fade[MAX_PARTICLES]; // Vida em ticks de 1/60s; fade = 1 / vida inicial
+  float size[MAX_PARTICLES];
+  uint32_t color[MAX_PARTICLES]; // RGBA, um byte por canal
+  uint64_t rng;
+} Particles;
+
+void ParticlesInit(Particles* p, uint64_t seed);
+void ParticlesClear(Particles* p);
+int  ParticlesBurst(Particles* p, int n, float x, float y, float speed, float life, float size, uint32_t color);
+int  ParticlesField(Particles* p, int n, float w, float h, float vy, float size, uint32_t color);
+void ParticlesUpdate(Particles* p, float dt, float gravity);
+void ParticlesWrap(Particles* p, float top, float bottom);
+void ParticlesReap(Particles* p);
+
+#endif
@@ -0,0 +1,61 @@
+#include "policy.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Nao aperta nada
+Input PolicyIdle(Game* g, PolicyState* state) {
+  return 0;
+}
+
+// Aperta teclas aleatorias, troca de ideia a cada poucos ticks
+Input PolicyRandom(Game* g, PolicyState* state) {
+  state->rng = state->rng * 6364136223846793005ULL + 1442695040888963407ULL;
+  if ((state->rng >> 60) == 0) state->held = (state->rng >> 32) & (IN_LEFT | IN_RIGHT | IN_SHOOT);
+  return state->held;
+}
+
+// Segue o inimigo vivo mais proximo, foge de tiros e nao atira em barreira
+// Mira onde o inimigo vai estar quando o tiro chegar, pela velocidade da formacao no ultimo tick
+Input PolicyTrack(Game* g, PolicyState* state) {
+  float px = g->player.pos.x + SHIP_WIDTH / 2.0, best = 1e9, target = px;
+  Formation* f = &g->enemies;
+  for (int k = 0; k < f->count; k++) {
+    if (!f->alive[k]) continue;
+    float ex = f->x[k] + f->size / 2 + f->dx * (g->player.pos.y - f->y[k]) / PLAYER_BULLET_SPEED;
+    if (abs((int) (ex - px)) < best) best = abs((int) (ex - px)), target = ex;
+  }
+
+  Input input = 0;
+  if (target > px + 4) input |= IN_RIGHT;
+  if (target < px - 4) input |= IN_LEFT;
+
+  // Barreira furada so cobre se ainda tiver pixel nas colunas por onde o tiro passaria
+  // Embaixo do alvo atira mesmo assim, o tiro vai furando ate passar
+  int covered = 0;
+  for (int i = 0; i < LEN(g->barriers); i++) {
+    Barrier* bar = &g->barriers[i];
+    // Mesmas colunas que o teste de colisao: borda direita exclusiva, e floorf porque o cast leva -0.5 pra coluna 0
+    int c0 = MAX(0, (int) floorf(px - BULLET_WIDTH / 2.0 - bar->pos.x));
+    int c1 = MIN(SPRITE_SIZE - 1, (int) ceilf(px + BULLET_WIDTH / 2.0 - bar->pos.x) - 1);
+    if (!bar->hp || c0 > c1) continue;
+    uint32_t columns = ((2u << c1) - 1) & ~((1u << c0) - 1);
+    for (int r = 0; r < SPRITE_SIZE; r++)
+      if (bar->pixels.rows[r] & columns) covered = 1;
+  }
+  if (!covered || !(input & (IN_LEFT | IN_RIGHT))) input |= IN_SHOOT;
+
+  // Desvia de tiro inimigo vindo em cima
+  Bullets* b = &g->bullets;
+  for (int n = 0; n < b->count; n++) {
+    if (b->owner[n] != OWNER_ENEMY || b->y[n] < g->player.pos.y - 120) continue;
+    if (b->x[n] + BULLET_WIDTH > g->player.pos.x - 8 && b->x[n] < g->player.pos.x + SHIP_WIDTH + 8)
+      return (input & IN_SHOOT) | (b->x[n] < px ? IN_RIGHT : IN_LEFT);
+  }
+  return input;
+}
+
+// idle, random ou track; qualquer outro nome vira track
+Policy PolicyByName(const char* name) {
+  return !strcmp(name, "idle") ? PolicyIdle : !strcmp(name, "random") ? PolicyRandom : PolicyTrack;
+}
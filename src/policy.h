@@ -0,0 +1,20 @@
+#ifndef POLICY_H
+#define POLICY_H
+
+// Jogadores automaticos pros rounds headless
+
+#include "sim.h"
+
+typedef struct {
+  uint64_t rng;
+  Input held;
+} PolicyState;
+
+typedef Input (*Policy)(Game* g, PolicyState* state);
+
+Input  PolicyIdle(Game* g, PolicyState* state);
+Input  PolicyRandom(Game* g, PolicyState* state);
+Input  PolicyTrack(Game* g, PolicyState* state);
+Policy PolicyByName(const char* name);
+
+#endif
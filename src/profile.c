@@ -0,0 +1,94 @@
+#include "profile.h"
+#include "clock.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+Profiler profiler;
+
+static void Record(ProfileZone zone);
+
+// ---
+
+void ProfileFrameBegin() {
+  profiler.enabled = profiler.wanted || profiler.capturing;
+  profiler.frame_start = MonotonicNs(NULL);
+  profiler.num_zones = 0;
+  profiler.depth = 0;
+}
+
+// Fecha o frame: guarda as zonas pro overlay e soma o tempo no grafico e no histograma
+void ProfileFrameEnd() {
+  uint64_t end = MonotonicNs(NULL);
+  float ms = (end - profiler.frame_start) / 1e6;
+
+  profiler.history[profiler.history_pos] = ms;
+  profiler.history_pos = (profiler.history_pos + 1) % PROFILE_HISTORY;
+  profiler.histogram[ms < PROFILE_BUCKETS - 1 ? (int) ms : PROFILE_BUCKETS - 1]++;
+
+  if (!profiler.enabled) return;
+  while (profiler.depth) ProfileEnd();
+  for (int i = 0; i < profiler.num_zones; i++) profiler.last[i] = profiler.zones[i];
+  profiler.num_last = profiler.num_zones;
+  Record((ProfileZone) { "Frame", profiler.frame_start, end, -1 });
+}
+
+// Zonas alem dos limites ainda contam na pilha, so nao sao guardadas
+void ProfileBegin(const char* name) {
+  int depth = profiler.depth++;
+  if (depth >= PROFILE_MAX_DEPTH) return;
+  int i = profiler.num_zones < PROFILE_MAX_ZONES ? profiler.num_zones++ : -1;
+  profiler.stack[depth] = i;
+  if (i >= 0) profiler.zones[i] = (ProfileZone) { name, MonotonicNs(NULL), 0, depth };
+}
+
+void ProfileEnd() {
+  if (!profiler.depth || --profiler.depth >= PROFILE_MAX_DEPTH) return;
+  int i = profiler.stack[profiler.depth];
+  if (i < 0) return;
+  profiler.zones[i].end = MonotonicNs(NULL);
+  Record(profiler.zones[i]);
+}
+
+void ProfileEnable(int enabled) {
+  profiler.wanted = enabled;
+}
+
+// Reserva o buffer da captura; o profiler fica ligado ate o ProfileCaptureStop
+int ProfileCaptureStart() {
+  if (profiler.capturing) return 1;
+  profiler.trace = malloc(PROFILE_TRACE_EVENTS * sizeof(ProfileZone));
+  if (!profiler.trace) return 0;
+  profiler.trace_count = 0;
+  profiler.trace_start = MonotonicNs(NULL);
+  profiler.capturing = 1;
+  return 1;
+}
+
+// Escreve a captura no formato JSON de trace event, abre no chrome://tracing ou no Perfetto
+int ProfileCaptureStop(const char* path) {
+  if (!profiler.capturing) return 0;
+  profiler.capturing = 0;
+
+  FILE* f = fopen(path, "w");
+  if (f) {
+    fprintf(f, "{\"traceEvents\":[\n");
+    for (int i = 0; i < profiler.trace_count; i++) {
+      ProfileZone* z = &profiler.trace[i];
+      fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}\n", i ? "," : "",
+              z->name, (z->start - profiler.trace_start) / 1e3, (z->end - z->start) / 1e3);
+    }
+    fprintf(f, "],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(f);
+  }
+
+  int count = profiler.trace_count;
+  free(profiler.trace);
+  profiler.trace = NULL;
+  return f ? count : 0;
+}
+
+// Guarda a zona fechada na captura, descartando o que passar do buffer
+static void Record(ProfileZone zone) {
+  if (!profiler.capturing || profiler.trace_count == PROFILE_TRACE_EVENTS) return;
+  profiler.trace[profiler.trace_count++] = zone;
+}
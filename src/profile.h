@@ -0,0 +1,65 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// Profiler de zonas por frame, com historico de tempo de frame e export pro Chrome/Perfetto
+// Com PROFILER 0 as macros somem; compilado mas desligado custa um if por zona
+
+#include <stdint.h>
+
+#ifndef PROFILER
+#define PROFILER 1
+#endif
+
+#define PROFILE_MAX_ZONES    256     // Zonas guardadas por frame
+#define PROFILE_MAX_DEPTH    16
+#define PROFILE_HISTORY      240     // Frames no grafico
+#define PROFILE_BUCKETS      34      // Histograma de 1 ms por balde, o ultimo junta o resto
+#define PROFILE_TRACE_EVENTS (1 << 18)
+
+typedef struct {
+  const char* name; // Sempre literal, so o ponteiro e guardado
+  uint64_t start, end;
+  int depth;
+} ProfileZone;
+
+typedef struct {
+  int enabled, capturing;
+  int wanted; // Ligar e desligar so vale no proximo frame, pra nao cortar uma zona no meio
+  uint64_t frame_start;
+
+  ProfileZone zones[PROFILE_MAX_ZONES], last[PROFILE_MAX_ZONES]; // Frame atual e o ultimo completo
+  int num_zones, num_last;
+  int stack[PROFILE_MAX_DEPTH], depth;
+
+  float history[PROFILE_HISTORY]; // Em ms, circular
+  int history_pos;
+  int histogram[PROFILE_BUCKETS];
+
+  ProfileZone* trace; // So existe durante a captura
+  int trace_count;
+  uint64_t trace_start;
+} Profiler;
+
+extern Profiler profiler;
+
+#if PROFILER
+#define PROFILE_FRAME_BEGIN() ProfileFrameBegin()
+#define PROFILE_FRAME_END()   ProfileFrameEnd()
+#define PROFILE_BEGIN(name)   do { if (profiler.enabled) ProfileBegin(name); } while (0)
+#define PROFILE_END()         do { if (profiler.enabled) ProfileEnd(); } while (0)
+#else
+#define PROFILE_FRAME_BEGIN()
+#define PROFILE_FRAME_END()
+#define PROFILE_BEGIN(name)
+#define PROFILE_END()
+#endif
+
+void ProfileFrameBegin();
+void ProfileFrameEnd();
+void ProfileBegin(const char* name);
+void ProfileEnd();
+void ProfileEnable(int enabled);
+int  ProfileCaptureStart();
+int  ProfileCaptureStop(const char* path);
+
+#endif
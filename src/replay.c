@@ -0,0 +1,217 @@
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+static void Put(ReplayRecorder* r, const void* data, size_t size);
+static void PutVarint(ReplayRecorder* r, uint64_t x);
+static void Flush(ReplayRecorder* r);
+static int  GetVarint(ReplayPlayer* p, uint64_t* x);
+static int  SyncParent(const char* path);
+
+// ---
+
+// Guarda o estado que o SimNewRun nao zera; chamado antes do primeiro SimStartRound da partida
+void ReplayBegin(ReplayRecorder* r, Game* g, const char* nick) {
+  r->header = (ReplayHeader) {
+    .magic = REPLAY_MAGIC, .version = REPLAY_VERSION, .mode = g->mode, .level = g->level,
+    .player_bullets = g->player_bullets, .player_fire_delay = g->player_fire_delay,
+    .rng = g->rng, .tick = g->tick, .masked = g->masks != NULL
+  };
+  if (g->masks) r->header.masks = *g->masks;
+  memcpy(r->header.nick, nick, 3);
+  r->size = 0;
+  r->held = 0;
+  r->run = 0;
+  r->recording = 1;
+  Put(r, &r->header, sizeof(r->header));
+}
+
+void ReplayRound(ReplayRecorder* r) {
+  if (!r->recording) return;
+  Flush(r);
+  uint8_t op = REPLAY_OP_ROUND;
+  Put(r, &op, 1);
+}
+
+void ReplayTick(ReplayRecorder* r, Input input) {
+  if (!r->recording) return;
+  if (input != r->held) Flush(r);
+  r->held = input;
+  r->run++;
+}
+
+void ReplayEnd(ReplayRecorder* r, Game* g) {
+  if (!r->recording) return;
+  Flush(r);
+  uint8_t op = REPLAY_OP_END;
+  Put(r, &op, 1);
+  PutVarint(r, g->pts);
+  PutVarint(r, g->level);
+  PutVarint(r, g->tick - r->header.tick);
+  r->recording = 0;
+}
+
+int ReplaySave(ReplayRecorder* r, const char* path) {
+  return r->data && ReplayWrite(path, r->data, r->size);
+}
+
+// Escreve num temporario, espera chegar no disco e renomeia, pra nunca deixar um replay pela metade
+// O fsync da pasta depois e o que garante que o rename em si sobrevive a um corte de energia
+int ReplayWrite(const char* path, const void* data, size_t size) {
+  char tmp[1024];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  FILE* f = fopen(tmp, "wb");
+  if (!f) return 0;
+  int ok = fwrite(data, 1, size, f) == size;
+  ok = !fflush(f) && !fsync(fileno(f)) && ok;
+  ok &= !fclose(f);
+  if (ok) ok = !rename(tmp, path);
+  if (!ok) {
+    remove(tmp);
+    return 0;
+  }
+  return SyncParent(path);
+}
+
+// Passa o que foi gravado pra quem chama, que fica com o free; a proxima gravacao comeca um buffer novo
+uint8_t* ReplayTake(ReplayRecorder* r, size_t* size) {
+  uint8_t* data = r->data;
+  *size = r->size;
+  r->data = NULL;
+  r->size = r->capacity = 0;
+  return data;
+}
+
+void ReplayDiscard(ReplayRecorder* r) {
+  free(r->data);
+  *r = (ReplayRecorder) { 0 };
+}
+
+int ReplayLoad(ReplayPlayer* p, const char* path) {
+  *p = (ReplayPlayer) { 0 };
+  FILE* f = fopen(path, "rb");
+  if (!f) return 0;
+  fseek(f, 0, SEEK_END);
+  long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  p->data = size > (long) sizeof(ReplayHeader) ? malloc(size) : NULL;
+  int ok = p->data && fread(p->data, 1, size, f) == (size_t) size;
+  fclose(f);
+  if (ok) {
+    memcpy(&p->header, p->data, sizeof(p->header));
+    ok = p->header.magic == REPLAY_MAGIC && p->header.version == REPLAY_VERSION;
+  }
+  if (!ok) {
+    ReplayUnload(p);
+    return 0;
+  }
+  p->size = size;
+  p->pos = sizeof(ReplayHeader);
+  return 1;
+}
+
+// Deixa a sim no mesmo ponto em que a gravacao comecou; o Game ja deve ter passado pelo SimInit
+void ReplayStart(ReplayPlayer* p, Game* g) {
+  SimNewRun(g);
+  g->mode = p->header.mode;
+  g->level = p->header.level;
+  g->player_bullets = p->header.player_bullets;
+  g->player_fire_delay = p->header.player_fire_delay;
+  g->rng = p->header.rng;
+  g->tick = p->header.tick;
+  g->masks = p->header.masked ? &p->header.masks : NULL;
+  p->pos = sizeof(ReplayHeader);
+  p->left = 0;
+}
+
+// Proximo passo da partida: um tick com a entrada, o inicio de um round ou o fim
+ReplayStep ReplayNext(ReplayPlayer* p, Input* input) {
+  while (!p->left) {
+    if (p->pos >= p->size) return REPLAY_ERROR;
+    uint8_t op = p->data[p->pos++];
+    uint64_t a, b, c;
+    if (op == REPLAY_OP_ROUND) return REPLAY_ROUND;
+    if (op == REPLAY_OP_END) {
+      if (!GetVarint(p, &a) || !GetVarint(p, &b) || !GetVarint(p, &c)) return REPLAY_ERROR;
+      p->pts = a;
+      p->level = b;
+      p->ticks = c;
+      return REPLAY_END;
+    }
+    if (op > REPLAY_OP_ROUND || !GetVarint(p, &a)) return REPLAY_ERROR;
+    p->held = op;
+    p->left = a;
+  }
+  p->left--;
+  *input = p->held;
+  return REPLAY_TICK;
+}
+
+void ReplayUnload(ReplayPlayer* p) {
+  free(p->data);
+  p->data = NULL;
+  p->size = p->pos = 0;
+}
+
+// Buffer que dobra de tamanho, uma partida longa fica em poucos KB
+static void Put(ReplayRecorder* r, const void* data, size_t size) {
+  if (r->size + size > r->capacity) {
+    size_t capacity = MAX(4096, r->capacity * 2);
+    uint8_t* grown = realloc(r->data, capacity);
+    if (!grown) {
+      r->recording = 0;
+      return;
+    }
+    r->data = grown;
+    r->capacity = capacity;
+  }
+  memcpy(r->data + r->size, data, size);
+  r->size += size;
+}
+
+// 7 bits por byte, o bit alto diz que tem mais
+static void PutVarint(ReplayRecorder* r, uint64_t x) {
+  uint8_t buf[10];
+  int n = 0;
+  do {
+    buf[n] = x & 0x7f;
+    x >>= 7;
+    if (x) buf[n] |= 0x80;
+    n++;
+  } while (x);
+  Put(r, buf, n);
+}
+
+// Escreve a entrada que estava segurada e quantos ticks durou
+static void Flush(ReplayRecorder* r) {
+  if (!r->run) return;
+  Put(r, &r->held, 1);
+  PutVarint(r, r->run);
+  r->run = 0;
+}
+
+static int GetVarint(ReplayPlayer* p, uint64_t* x) {
+  *x = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (p->pos >= p->size) return 0;
+    uint8_t byte = p->data[p->pos++];
+    *x |= (uint64_t) (byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return 1;
+  }
+  return 0;
+}
+
+// fsync da pasta onde o arquivo esta, "." se o caminho nao tem pasta
+static int SyncParent(const char* path) {
+  char dir[1024] = ".";
+  const char* slash = strrchr(path, '/');
+  if (slash) snprintf(dir, sizeof(dir), "%.*s", (int) (slash - path + (slash == path)), path);
+  int fd = open(dir, O_RDONLY | O_DIRECTORY);
+  if (fd < 0) return 0;
+  int ok = !fsync(fd);
+  return !close(fd) && ok;
+}
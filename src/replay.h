@@ -0,0 +1,70 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// Replay de uma partida: estado inicial da sim + entrada de cada tick
+// Layout: ReplayHeader, depois uma sequencia de comandos
+//   0x00-0x7f <varint n>   entrada repetida por n ticks
+//   REPLAY_OP_ROUND        SimStartRound
+//   REPLAY_OP_END <varint pts> <varint level> <varint ticks>   resultado, pra conferir
+
+#include "sim.h"
+#include <stddef.h>
+
+#define REPLAY_MAGIC   0x50524953 // "SIRP"
+#define REPLAY_VERSION 4 // 2: colisao varrida; 3: mascaras dos sprites no cabecalho; 4: barreiras por pixel
+
+typedef enum {
+  REPLAY_OP_ROUND = 0x80,
+  REPLAY_OP_END   = 0x81
+} ReplayOp;
+
+typedef enum {
+  REPLAY_TICK, REPLAY_ROUND, REPLAY_END, REPLAY_ERROR
+} ReplayStep;
+
+typedef struct {
+  uint32_t magic, version;
+  char nick[4];
+  uint8_t mode, level, masked, reserved; // level = ultimo level jogado antes da partida, normalmente 0
+  int32_t player_bullets, player_fire_delay;
+  uint64_t rng;
+  int64_t tick;
+  SpriteMasks masks; // Colisao por pixel da partida, so vale com masked; o headless nao tem as imagens pra montar
+} ReplayHeader;
+
+// Gravacao: a entrada so e escrita quando muda
+typedef struct {
+  ReplayHeader header;
+  uint8_t* data;
+  size_t size, capacity;
+  Input held;
+  uint32_t run; // Ticks seguidos com held, ainda nao escritos
+  int recording;
+} ReplayRecorder;
+
+// Reproducao a partir do arquivo inteiro em memoria; o Game aponta pras mascaras do header enquanto ele existir
+typedef struct {
+  ReplayHeader header;
+  uint8_t* data;
+  size_t size, pos;
+  Input held;
+  uint32_t left; // Ticks restantes com held
+  int pts, level;
+  int64_t ticks;
+} ReplayPlayer;
+
+void ReplayBegin(ReplayRecorder* r, Game* g, const char* nick);
+void ReplayRound(ReplayRecorder* r);
+void ReplayTick(ReplayRecorder* r, Input input);
+void ReplayEnd(ReplayRecorder* r, Game* g);
+int  ReplaySave(ReplayRecorder* r, const char* path);
+int  ReplayWrite(const char* path, const void* data, size_t size);
+uint8_t* ReplayTake(ReplayRecorder* r, size_t* size);
+void ReplayDiscard(ReplayRecorder* r);
+
+int  ReplayLoad(ReplayPlayer* p, const char* path);
+void ReplayStart(ReplayPlayer* p, Game* g);
+ReplayStep ReplayNext(ReplayPlayer* p, Input* input);
+void ReplayUnload(ReplayPlayer* p);
+
+#endif
@@ -0,0 +1,265 @@
+#include "rewind.h"
+#include <stdlib.h>
+#include <string.h>
+
+static RewindFrame* Frame(Rewind* r, int64_t tick);
+static RewindFrame* Nth(Rewind* r, int i);
+static int    Reserve(Rewind* r, size_t length);
+static void   Evict(Rewind* r);
+static void   Trim(Rewind* r, int64_t tick);
+static size_t Capture(Game* g, uint8_t* image);
+static void   Restore(Game* g, uint8_t* image, size_t size);
+static void   Apply(Rewind* r, RewindFrame* f);
+static size_t Encode(const uint8_t* cur, size_t n, const uint8_t* prev, size_t prev_n, uint8_t* out);
+static size_t SkipSame(const uint8_t* cur, size_t n, const uint8_t* prev, size_t prev_n, size_t i);
+
+// budget = bytes dos registros; as imagens de trabalho sao a parte, do tamanho do maior estado
+int RewindInit(Rewind* r, size_t budget) {
+  memset(r, 0, sizeof(*r));
+  r->budget = budget;
+  r->capacity = sizeof(Game) + SIM_ARENA_SIZE;
+  r->data   = malloc(budget);
+  r->frames = malloc(REWIND_MAX_FRAMES * sizeof(RewindFrame));
+  r->image  = malloc(r->capacity);
+  r->next   = malloc(r->capacity);
+  r->cursor = malloc(r->capacity);
+  r->quick  = malloc(r->capacity);
+  r->packed = malloc(r->capacity * 2 + 16); // Pior caso do Encode, com os cabecalhos
+  if (r->data && r->frames && r->image && r->next && r->cursor && r->quick && r->packed) {
+    RewindClear(r);
+    return 1;
+  }
+  RewindFree(r);
+  return 0;
+}
+
+void RewindFree(Rewind* r) {
+  free(r->data);
+  free(r->frames);
+  free(r->image);
+  free(r->next);
+  free(r->cursor);
+  free(r->quick);
+  free(r->packed);
+  memset(r, 0, sizeof(*r));
+}
+
+void RewindClear(Rewind* r) {
+  r->first = r->count = 0;
+  r->end = r->bytes = 0;
+  r->image_size = 0;
+  r->cursor_tick = -1;
+}
+
+// Grava o estado depois do tick g->tick
+// Um tick que ja existe (voltou e continuou jogando) apaga dali pra frente e comeca um keyframe; um buraco comeca tudo de novo
+void RewindPush(Rewind* r, Game* g) {
+  int key = !r->count;
+  if (r->count && (g->tick <= RewindFirst(r) || g->tick > RewindLast(r) + 1)) {
+    RewindClear(r);
+    key = 1;
+  }
+  else if (r->count && g->tick <= RewindLast(r)) {
+    Trim(r, g->tick);
+    key = 1;
+  }
+  if (!key && g->tick - Nth(r, r->count - 1)->key >= REWIND_KEYFRAME) key = 1;
+
+  size_t n = Capture(g, r->next);
+  size_t length = Encode(r->next, n, key ? NULL : r->image, key ? 0 : r->image_size, r->packed);
+  if (!Reserve(r, length)) {
+    RewindClear(r);
+    return;
+  }
+  // O grupo do tick anterior saiu pra abrir espaco, entao esse vira keyframe
+  if (!key && !r->count) {
+    key = 1;
+    length = Encode(r->next, n, NULL, 0, r->packed);
+    if (!Reserve(r, length)) {
+      RewindClear(r);
+      return;
+    }
+  }
+
+  RewindFrame* f = Nth(r, r->count);
+  *f = (RewindFrame) { g->tick, key ? g->tick : Nth(r, r->count - 1)->key, r->end, length, n };
+  memcpy(r->data + r->end, r->packed, length);
+  r->end += length;
+  r->bytes += length;
+  r->count++;
+
+  uint8_t* tmp = r->image;
+  r->image = r->next;
+  r->next = tmp;
+  r->image_size = n;
+}
+
+// Volta o jogo pro estado gravado no tick; 0 se ele nao esta mais (ou ainda nao esta) no historico
+// Andar pra frente continua do ultimo decodificado; pra tras recomeca no keyframe do grupo
+int RewindSeek(Rewind* r, Game* g, int64_t tick) {
+  RewindFrame* f = Frame(r, tick);
+  if (!f) return 0;
+  int64_t t = r->cursor_tick >= f->key && r->cursor_tick <= tick ? r->cursor_tick + 1 : f->key;
+  for (; t <= tick; t++) Apply(r, Frame(r, t));
+  r->cursor_tick = tick;
+  Restore(g, r->cursor, f->size);
+  return 1;
+}
+
+int64_t RewindFirst(Rewind* r) {
+  return r->count ? Nth(r, 0)->tick : -1;
+}
+
+int64_t RewindLast(Rewind* r) {
+  return r->count ? Nth(r, r->count - 1)->tick : -1;
+}
+
+// Uma imagem inteira fora do anel, nunca expira
+void RewindQuickSave(Rewind* r, Game* g) {
+  r->quick_size = Capture(g, r->quick);
+}
+
+int RewindQuickLoad(Rewind* r, Game* g) {
+  if (!r->quick_size) return 0;
+  Restore(g, r->quick, r->quick_size);
+  return 1;
+}
+
+void RewindQuickDrop(Rewind* r) {
+  r->quick_size = 0;
+}
+
+// ---
+
+// Ticks gravados sao contiguos, entao o indice sai direto da diferenca pro primeiro
+static RewindFrame* Frame(Rewind* r, int64_t tick) {
+  if (!r->count || tick < RewindFirst(r) || tick > RewindLast(r)) return NULL;
+  return Nth(r, tick - RewindFirst(r));
+}
+
+static RewindFrame* Nth(Rewind* r, int i) {
+  return &r->frames[(r->first + i) % REWIND_MAX_FRAMES];
+}
+
+// Acha lugar contiguo pro registro em r->end, tirando os grupos mais velhos ate caber
+// Os registros vivos ficam em [oldest, end) ou, depois de dar a volta, em [oldest, budget) e [0, end)
+static int Reserve(Rewind* r, size_t length) {
+  for (;;) {
+    if (!r->count) {
+      r->end = 0;
+      return length <= r->budget;
+    }
+    size_t oldest = Nth(r, 0)->offset;
+    if (r->count == REWIND_MAX_FRAMES) Evict(r);
+    else if (r->end > oldest && r->end + length <= r->budget) return 1;
+    else if (r->end > oldest && length <= oldest) {
+      r->end = 0;
+      return 1;
+    }
+    else if (r->end <= oldest && r->end + length <= oldest) return 1;
+    else Evict(r);
+  }
+}
+
+// Tira o grupo mais velho inteiro, deltas sem o keyframe nao servem pra nada
+static void Evict(Rewind* r) {
+  do {
+    r->bytes -= Nth(r, 0)->length;
+    r->first = (r->first + 1) % REWIND_MAX_FRAMES;
+    r->count--;
+    r->evicted++;
+  } while (r->count && Nth(r, 0)->tick != Nth(r, 0)->key);
+  if (r->cursor_tick < RewindFirst(r)) r->cursor_tick = -1;
+}
+
+// Apaga os ticks >= tick
+static void Trim(Rewind* r, int64_t tick) {
+  while (r->count && RewindLast(r) >= tick) r->bytes -= Nth(r, --r->count)->length;
+  if (r->count) r->end = Nth(r, r->count - 1)->offset + Nth(r, r->count - 1)->length;
+  if (r->cursor_tick >= tick) r->cursor_tick = -1;
+}
+
+static size_t Capture(Game* g, uint8_t* image) {
+  memcpy(image, g, sizeof(Game));
+  memcpy(image + sizeof(Game), g->arena.base, g->arena.used);
+  return sizeof(Game) + g->arena.used;
+}
+
+static void Restore(Game* g, uint8_t* image, size_t size) {
+  memcpy(g, image, sizeof(Game));
+  memcpy(g->arena.base, image + sizeof(Game), size - sizeof(Game));
+}
+
+// ---
+
+static uint8_t* PutVarint(uint8_t* o, size_t v) {
+  for (; v >= 0x80; v >>= 7) *o++ = v | 0x80;
+  *o++ = v;
+  return o;
+}
+
+static size_t GetVarint(const uint8_t** p) {
+  size_t v = 0;
+  for (int shift = 0;; shift += 7) {
+    uint8_t b = *(*p)++;
+    v |= (size_t) (b & 0x7f) << shift;
+    if (b < 0x80) return v;
+  }
+}
+
+// Registro: pares <varint iguais> <varint diferentes> seguidos dos bytes diferentes ja com XOR
+// O que sobra depois do ultimo par e igual; a imagem anterior vale zero depois do fim dela
+static size_t Encode(const uint8_t* cur, size_t n, const uint8_t* prev, size_t prev_n, uint8_t* out) {
+  uint8_t* o = out;
+  size_t i = 0;
+  while (i < n) {
+    size_t run = i;
+    i = SkipSame(cur, n, prev, prev_n, i);
+    if (i == n) break;
+
+    // Os diferentes vao ate aparecerem 4 iguais seguidos; menos que isso custa mais que o cabecalho de um par novo
+    size_t lit = i;
+    while (i < n && SkipSame(cur, MIN(n, i + 4), prev, prev_n, i) < MIN(n, i + 4)) i++;
+    o = PutVarint(o, lit - run);
+    o = PutVarint(o, i - lit);
+    for (size_t j = lit; j < i; j++) *o++ = cur[j] ^ (j < prev_n ? prev[j] : 0);
+  }
+  return o - out;
+}
+
+// Primeiro indice >= i em que cur e prev diferem, ou n; compara 8 bytes por vez
+static size_t SkipSame(const uint8_t* cur, size_t n, const uint8_t* prev, size_t prev_n, size_t i) {
+  uint64_t a, b = 0;
+  size_t both = MIN(n, prev_n);
+  for (; i + 8 <= both; i += 8) {
+    memcpy(&a, cur + i, 8);
+    memcpy(&b, prev + i, 8);
+    if (a != b) break;
+  }
+  while (i < both && cur[i] == prev[i]) i++;
+  if (i < both) return i;
+
+  for (; i + 8 <= n; i += 8) {
+    memcpy(&a, cur + i, 8);
+    if (a) break;
+  }
+  while (i < n && !cur[i]) i++;
+  return i;
+}
+
+// Decodifica um registro por cima do cursor; keyframe parte do zero
+static void Apply(Rewind* r, RewindFrame* f) {
+  if (f->tick == f->key) memset(r->cursor, 0, f->size);
+  else if (f->size > r->cursor_size) memset(r->cursor + r->cursor_size, 0, f->size - r->cursor_size);
+  r->cursor_size = f->size;
+
+  const uint8_t* in = r->data + f->offset, * end = in + f->length;
+  uint8_t* out = r->cursor;
+  while (in < end) {
+    out += GetVarint(&in);
+    size_t lit = GetVarint(&in);
+    for (size_t j = 0; j < lit; j++) out[j] ^= in[j];
+    out += lit;
+    in += lit;
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+// Historico de estados da simulacao pra voltar no tempo e quick-save
+// Um estado e a imagem do Game seguida dos bytes usados da arena; a arena fica no mesmo endereco,
+// entao copiar a imagem de volta no mesmo Game deixa os ponteiros da formacao validos
+// Cada tick vira o XOR contra o anterior com as sequencias de zero comprimidas; a cada REWIND_KEYFRAME ticks
+// vai um keyframe (XOR contra zero). Voltar pra um tick decodifica no maximo um keyframe e REWIND_KEYFRAME - 1 deltas
+// Os registros ficam num anel de bytes de tamanho fixo; quando enche, sai o grupo (keyframe e deltas) mais velho
+
+#include "sim.h"
+#include <stddef.h>
+
+#define REWIND_KEYFRAME   30                   // Ticks por grupo
+#define REWIND_BUDGET     (4 << 20)            // Bytes dos registros
+#define REWIND_MAX_FRAMES (TICK_RATE * 60 * 5) // Teto do indice, 5 minutos
+
+typedef struct {
+  int64_t tick, key; // key = tick do keyframe do grupo
+  uint32_t offset, length; // Registro no anel
+  uint32_t size; // Tamanho da imagem
+} RewindFrame;
+
+typedef struct {
+  uint8_t* data;
+  size_t budget, end, bytes; // end = onde vai o proximo registro; bytes = soma dos registros vivos
+  RewindFrame* frames;
+  int first, count;
+
+  uint8_t* image, * next, * packed; // Ultimo estado gravado, o que esta sendo gravado e o registro codificado
+  size_t image_size, capacity;
+  uint8_t* cursor; // Ultimo estado decodificado, pra andar pra frente sem voltar ao keyframe
+  size_t cursor_size;
+  int64_t cursor_tick;
+
+  uint8_t* quick;
+  size_t quick_size;
+  long evicted;
+} Rewind;
+
+int  RewindInit(Rewind* r, size_t budget);
+void RewindFree(Rewind* r);
+void RewindClear(Rewind* r);
+void RewindPush(Rewind* r, Game* g);
+int  RewindSeek(Rewind* r, Game* g, int64_t tick);
+int64_t RewindFirst(Rewind* r);
+int64_t RewindLast(Rewind* r);
+void RewindQuickSave(Rewind* r, Game* g);
+int  RewindQuickLoad(Rewind* r, Game* g);
+void RewindQuickDrop(Rewind* r);
+
+#endif
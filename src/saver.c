@@ -0,0 +1,97 @@
+#include "saver.h"
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void* SaverWorker(void* arg);
+static int   Push(Saver* s, SaveJob* job);
+static void  Run(Saver* s, SaveJob* job);
+
+// ---
+
+int SaverStart(Saver* s, ScoreStore* store, const char* replay_dir) {
+  s->store = store;
+  snprintf(s->replay_dir, sizeof(s->replay_dir), "%s", replay_dir);
+  s->head = s->count = 0;
+  s->running = 1;
+  atomic_store(&s->failed, 0);
+  atomic_store(&s->dropped, 0);
+  pthread_mutex_init(&s->lock, NULL);
+  pthread_cond_init(&s->wake, NULL);
+  if (!pthread_create(&s->thread, NULL, SaverWorker, s)) return 1;
+  s->running = 0;
+  return 0;
+}
+
+// Espera a fila esvaziar; o historico volta a ser de quem chamou
+void SaverStop(Saver* s) {
+  if (!s->running) return;
+  pthread_mutex_lock(&s->lock);
+  s->running = 0;
+  pthread_cond_signal(&s->wake);
+  pthread_mutex_unlock(&s->lock);
+  pthread_join(s->thread, NULL);
+  pthread_cond_destroy(&s->wake);
+  pthread_mutex_destroy(&s->lock);
+}
+
+// Fica com data mesmo se nao couber, entao quem chama nunca da free
+int SaverRun(Saver* s, const char* nick, int pts, int mode, int level, int64_t time, uint8_t* data, size_t size) {
+  SaveJob job = { { 0 }, pts, mode, level, time, data, size };
+  memcpy(job.nick, nick, 3);
+  return Push(s, &job);
+}
+
+// ---
+
+static void* SaverWorker(void* arg) {
+  Saver* s = arg;
+  pthread_mutex_lock(&s->lock);
+  for (;;) {
+    while (s->running && !s->count) pthread_cond_wait(&s->wake, &s->lock);
+    if (!s->count) break;
+    SaveJob job = s->jobs[s->head];
+    s->head = (s->head + 1) % SAVER_QUEUE;
+    s->count--;
+    // Sem a trava enquanto escreve, o frame nunca espera o disco
+    pthread_mutex_unlock(&s->lock);
+    Run(s, &job);
+    pthread_mutex_lock(&s->lock);
+  }
+  pthread_mutex_unlock(&s->lock);
+  return NULL;
+}
+
+// So segura a trava pra copiar o pedido; fila cheia descarta em vez de esperar
+static int Push(Saver* s, SaveJob* job) {
+  int ok = 0;
+  if (s->running) {
+    pthread_mutex_lock(&s->lock);
+    if (s->count < SAVER_QUEUE) {
+      s->jobs[(s->head + s->count++) % SAVER_QUEUE] = *job;
+      pthread_cond_signal(&s->wake);
+      ok = 1;
+    }
+    pthread_mutex_unlock(&s->lock);
+  }
+  if (ok) return 1;
+  atomic_fetch_add(&s->dropped, 1);
+  free(job->data);
+  return 0;
+}
+
+// O replay leva o numero do registro que acabou de entrar no log, entao so e escrito se o append deu certo
+// Historico que nao abriu ja foi avisado no ScoresOpen
+static void Run(Saver* s, SaveJob* job) {
+  char path[sizeof(s->replay_dir) + 16] = "score";
+  int ok = s->store->fd >= 0 && ScoresAppend(s->store, job->nick, job->pts, job->mode, job->level, job->time);
+  if (ok && job->data) {
+    snprintf(path, sizeof(path), "%s/%06u.rep", s->replay_dir, (unsigned) (s->store->index.count - 1));
+    ok = ReplayWrite(path, job->data, job->size);
+  }
+  free(job->data);
+  if (ok || s->store->fd < 0) return;
+  atomic_fetch_add(&s->failed, 1);
+  fprintf(stderr, "SAVER: could not write %s\n", path);
+}
@@ -0,0 +1,39 @@
+#ifndef SAVER_H
+#define SAVER_H
+
+// Gravacao em disco fora da thread do jogo
+// O frame so poe o pedido numa fila; uma thread de I/O escreve, espera o fsync e renomeia
+// Depois do SaverStart o historico e dela, entao o menu usa uma copia do indice mantida em memoria
+
+#include "scores.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define SAVER_QUEUE 64 // Pedidos esperando; chega um por partida, o resto e folga pra disco lento
+
+// Uma partida terminada: a pontuacao e, se gravou, o replay
+typedef struct {
+  char nick[4];
+  int pts, mode, level;
+  int64_t time;
+  uint8_t* data; // Do replay ou NULL; a thread de I/O da o free depois de escrever
+  size_t size;
+} SaveJob;
+
+typedef struct {
+  ScoreStore* store;
+  char replay_dir[64];
+  SaveJob jobs[SAVER_QUEUE];
+  int head, count, running;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_t thread;
+  atomic_int failed, dropped; // Escritas que deram erro, pedidos que nao couberam na fila
+} Saver;
+
+int  SaverStart(Saver* s, ScoreStore* store, const char* replay_dir);
+void SaverStop(Saver* s);
+int  SaverRun(Saver* s, const char* nick, int pts, int mode, int level, int64_t time, uint8_t* data, size_t size);
+
+#endif
@@ -0,0 +1,215 @@
+#include "scores.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define RECORD_CRC_SIZE offsetof(ScoreRecord, crc)
+#define INDEX_CRC_SIZE  offsetof(ScoreIndex, crc)
+
+static void     ResetIndex(ScoreIndex* index);
+static ScoreRecord MakeRecord(ScoreIndex* index, const char* nick, int pts, int mode, int level, int64_t time);
+static void     IndexRecord(ScoreIndex* index, ScoreRecord* rec);
+static int      LoadIndex(ScoreStore* s);
+static int      ReplayLog(ScoreStore* s);
+static int      NickSlot(const char* nick);
+static int      ValidRecord(ScoreRecord* rec);
+static int      SyncParent(const char* path);
+static void     BuildCrcTable();
+static uint32_t Crc32(const void* data, size_t size);
+
+static uint32_t crc_table[256];
+
+// ---
+
+// Abre ou cria o historico; so o que foi gravado depois do ultimo indice salvo e relido
+int ScoresOpen(ScoreStore* s, const char* log_path, const char* idx_path) {
+  BuildCrcTable();
+  ResetIndex(&s->index);
+  s->sync = 1;
+  s->pending = 0;
+  snprintf(s->idx_path, sizeof(s->idx_path), "%s", idx_path);
+
+  s->fd = open(log_path, O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (s->fd < 0) return 0;
+
+  off_t size = lseek(s->fd, 0, SEEK_END);
+  if (!LoadIndex(s) || s->index.count * sizeof(ScoreRecord) > size) ResetIndex(&s->index);
+  return ReplayLog(s);
+}
+
+void ScoresClose(ScoreStore* s) {
+  if (s->fd < 0) return;
+  if (s->pending) ScoresCheckpoint(s);
+  close(s->fd);
+  s->fd = -1;
+}
+
+// Grava um registro inteiro num write so; um corte de energia no meio deixa no maximo
+// um registro quebrado no fim, que o proximo ScoresOpen descarta
+int ScoresAppend(ScoreStore* s, const char* nick, int pts, int mode, int level, int64_t time) {
+  ScoreRecord rec = MakeRecord(&s->index, nick, pts, mode, level, time);
+  // Um write curto deixaria um pedaco no meio do log e os proximos registros depois dele, entao ele e cortado na hora
+  if (write(s->fd, &rec, sizeof(rec)) != sizeof(rec) || (s->sync && fdatasync(s->fd))) {
+    ftruncate(s->fd, (off_t) s->index.count * sizeof(ScoreRecord));
+    return 0;
+  }
+
+  IndexRecord(&s->index, &rec);
+  if (++s->pending >= SCORES_CHECKPOINT) ScoresCheckpoint(s);
+  return 1;
+}
+
+// Salva o indice num temporario e renomeia por cima, entao o antigo so some quando o novo esta inteiro
+// O fsync da pasta no fim e o que garante que o rename em si sobrevive a um corte de energia
+int ScoresCheckpoint(ScoreStore* s) {
+  char tmp[sizeof(s->idx_path) + 4];
+  snprintf(tmp, sizeof(tmp), "%s.tmp", s->idx_path);
+  s->index.crc = Crc32(&s->index, INDEX_CRC_SIZE);
+
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) return 0;
+  int ok = write(fd, &s->index, sizeof(s->index)) == sizeof(s->index);
+  if (s->sync) ok = ok && !fsync(fd);
+  ok = !close(fd) && ok && !rename(tmp, s->idx_path);
+  if (s->sync) ok = ok && SyncParent(s->idx_path);
+  if (ok) s->pending = 0;
+  return ok;
+}
+
+// So o indice, sem tocar no arquivo; da o mesmo resultado que o ScoresAppend daria nele
+void ScoresIndexAdd(ScoreIndex* index, const char* nick, int pts, int mode, int level, int64_t time) {
+  ScoreRecord rec = MakeRecord(index, nick, pts, mode, level, time);
+  IndexRecord(index, &rec);
+}
+
+// As k maiores, k ate SCORES_TOP
+int ScoresTop(const ScoreIndex* index, int k, ScoreRecord* out) {
+  int n = k < index->top_count ? k : index->top_count;
+  memcpy(out, index->top, n * sizeof(ScoreRecord));
+  return n;
+}
+
+// As n ultimas, da mais nova pra mais velha, n ate SCORES_RECENT
+int ScoresRecent(const ScoreIndex* index, int n, ScoreRecord* out) {
+  uint64_t count = index->count;
+  int i = 0;
+  for (; i < n && i < SCORES_RECENT && i < count; i++)
+    out[i] = index->recent[(count - 1 - i) % SCORES_RECENT];
+  return i;
+}
+
+// Melhor pontuacao do apelido e o numero do registro dela no log (o mesmo do replay), sem ler arquivo
+int ScoresBest(const ScoreIndex* index, const char* nick, int* pts, uint32_t* rec) {
+  int slot = NickSlot(nick);
+  if (slot < 0 || !index->best_rec[slot]) return 0;
+  *pts = index->best_pts[slot];
+  *rec = index->best_rec[slot] - 1;
+  return 1;
+}
+
+// ---
+
+static void ResetIndex(ScoreIndex* index) {
+  memset(index, 0, sizeof(*index));
+  index->magic = SCORES_MAGIC;
+  index->version = SCORES_VERSION;
+}
+
+static ScoreRecord MakeRecord(ScoreIndex* index, const char* nick, int pts, int mode, int level, int64_t time) {
+  ScoreRecord rec = { SCORES_MAGIC, { 0 }, pts, mode, level, 0, time, index->count };
+  memcpy(rec.nick, nick, 3);
+  rec.crc = Crc32(&rec, RECORD_CRC_SIZE);
+  return rec;
+}
+
+// Atualiza o indice com um registro novo em O(SCORES_TOP) no pior caso
+static void IndexRecord(ScoreIndex* index, ScoreRecord* rec) {
+  // Top: empates ficam atras de quem fez a pontuacao antes
+  int n = index->top_count;
+  if (n < SCORES_TOP || rec->pts > index->top[n - 1].pts) {
+    int i = n < SCORES_TOP ? n : n - 1;
+    for (; i > 0 && index->top[i - 1].pts < rec->pts; i--) index->top[i] = index->top[i - 1];
+    index->top[i] = *rec;
+    if (n < SCORES_TOP) index->top_count++;
+  }
+
+  index->recent[index->count % SCORES_RECENT] = *rec;
+
+  int slot = NickSlot(rec->nick);
+  if (slot >= 0 && (!index->best_rec[slot] || rec->pts > index->best_pts[slot])) {
+    index->best_pts[slot] = rec->pts;
+    index->best_rec[slot] = index->count + 1;
+  }
+
+  index->count++;
+}
+
+static int LoadIndex(ScoreStore* s) {
+  FILE* f = fopen(s->idx_path, "rb");
+  if (!f) return 0;
+  int ok = fread(&s->index, sizeof(s->index), 1, f) == 1;
+  fclose(f);
+  return ok && s->index.magic == SCORES_MAGIC && s->index.version == SCORES_VERSION &&
+         s->index.crc == Crc32(&s->index, INDEX_CRC_SIZE);
+}
+
+// Le os registros que ainda nao estao no indice; corta o log no primeiro registro quebrado
+static int ReplayLog(ScoreStore* s) {
+  ScoreRecord buf[256];
+  off_t offset = (off_t) s->index.count * sizeof(ScoreRecord);
+
+  for (;;) {
+    ssize_t got = pread(s->fd, buf, sizeof(buf), offset);
+    if (got < 0) return 0;
+    int n = got / sizeof(ScoreRecord), i = 0;
+    for (; i < n && ValidRecord(&buf[i]); i++) {
+      IndexRecord(&s->index, &buf[i]);
+      s->pending++;
+    }
+    offset += i * sizeof(ScoreRecord);
+    if (i < n || got % sizeof(ScoreRecord)) return !ftruncate(s->fd, offset);
+    if (!got) return 1;
+  }
+}
+
+// "AAA" vira 0, "ZZZ" vira 26^3 - 1; -1 se nao for so letra maiuscula
+static int NickSlot(const char* nick) {
+  int slot = 0;
+  for (int i = 0; i < 3; i++) {
+    if (nick[i] < 'A' || nick[i] > 'Z') return -1;
+    slot = slot * 26 + nick[i] - 'A';
+  }
+  return slot;
+}
+
+static int ValidRecord(ScoreRecord* rec) {
+  return rec->magic == SCORES_MAGIC && rec->crc == Crc32(rec, RECORD_CRC_SIZE);
+}
+
+// fsync da pasta onde o arquivo esta, "." se o caminho nao tem pasta
+static int SyncParent(const char* path) {
+  char dir[256] = ".";
+  const char* slash = strrchr(path, '/');
+  if (slash) snprintf(dir, sizeof(dir), "%.*s", (int) (slash - path + (slash == path)), path);
+  int fd = open(dir, O_RDONLY | O_DIRECTORY);
+  if (fd < 0) return 0;
+  int ok = !fsync(fd);
+  return !close(fd) && ok;
+}
+
+// Montada no ScoresOpen, antes de qualquer outra thread usar o historico; depois so e lida
+static void BuildCrcTable() {
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+    crc_table[i] = c;
+  }
+}
+
+static uint32_t Crc32(const void* data, size_t size) {
+  uint32_t crc = ~0u;
+  for (size_t i = 0; i < size; i++) crc = crc_table[(crc ^ ((const uint8_t*) data)[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
@@ -0,0 +1,56 @@
+#ifndef SCORES_H
+#define SCORES_H
+
+// Historico de pontuacoes: log binario so de append + indice compacto em memoria
+// O indice e salvo de tempos em tempos; ao abrir so o rabo do log depois dele e relido
+// As consultas so leem o indice, entao servem tanto pro do ScoreStore quanto pra uma copia em memoria
+// O ScoresOpen vem antes de tudo: ele monta a tabela do crc
+
+#include <stdint.h>
+
+#define SCORES_MAGIC      0x524f4353 // "SCOR"
+#define SCORES_VERSION    1
+#define SCORES_TOP        100
+#define SCORES_RECENT     64
+#define SCORES_NICKS      (26 * 26 * 26)
+#define SCORES_CHECKPOINT 1024 // Appends entre um salvamento do indice e outro
+
+// Registro de tamanho fixo, entao o n-esimo fica em n * sizeof(ScoreRecord)
+typedef struct {
+  uint32_t magic;
+  char nick[4];
+  int32_t pts;
+  uint8_t mode, level;
+  uint16_t reserved;
+  int64_t time;
+  uint32_t seq;
+  uint32_t crc; // crc32 dos bytes anteriores do registro
+} ScoreRecord;
+
+typedef struct {
+  uint32_t magic, version;
+  uint64_t count; // Registros do log que ja estao no indice
+  uint32_t top_count, reserved;
+  ScoreRecord top[SCORES_TOP];       // Maiores pontuacoes, em ordem decrescente
+  ScoreRecord recent[SCORES_RECENT]; // Anel com os ultimos, slot = numero % SCORES_RECENT
+  int32_t best_pts[SCORES_NICKS];    // Melhor de cada apelido de 3 letras
+  uint32_t best_rec[SCORES_NICKS];   // Numero do registro + 1, 0 se o apelido nunca jogou
+  uint32_t crc;
+} ScoreIndex;
+
+typedef struct {
+  int fd, sync, pending;
+  char idx_path[256];
+  ScoreIndex index;
+} ScoreStore;
+
+int  ScoresOpen(ScoreStore* s, const char* log_path, const char* idx_path);
+void ScoresClose(ScoreStore* s);
+int  ScoresAppend(ScoreStore* s, const char* nick, int pts, int mode, int level, int64_t time);
+int  ScoresCheckpoint(ScoreStore* s);
+void ScoresIndexAdd(ScoreIndex* index, const char* nick, int pts, int mode, int level, int64_t time);
+int  ScoresTop(const ScoreIndex* index, int k, ScoreRecord* out);
+int  ScoresRecent(const ScoreIndex* index, int n, ScoreRecord* out);
+int  ScoresBest(const ScoreIndex* index, const char* nick, int* pts, uint32_t* rec);
+
+#endif
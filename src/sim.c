@@ -0,0 +1,545 @@
+#include "sim.h"
+#include "collide.h"
+#include <math.h>
+
+// Corpos da grade de colisao; no empate do instante de contato ganha o id menor
+enum { BODY_PLAYER, BODY_PARTNER, BODY_BARRIER };
+
+static int  EnemyBulletHit(Game* g, CollideGrid* grid, int n);
+static int  PlayerBulletHit(Game* g, CollideGrid* grid, int n);
+static int  FirstBody(Game* g, CollideGrid* grid, Rectangle bullet, float dy, int first_id, float* toi);
+static int  SpawnBullet(Game* g, float x, float y, float vy, BulletOwner owner, int shooter);
+static void RemoveBullet(Game* g, int n);
+static void IndexFormation(Formation* f);
+static int  ShootScale(Formation* f);
+static void KillEnemy(Game* g, int k);
+static void HitBarrier(Game* g, int a, Rectangle bullet, float dy, float t);
+static int  ChipBarrier(Barrier* b, Rectangle bullet, float dy);
+static void MoveShip(Game* g, Ship* ship, Input input);
+static void ShipShoot(Game* g, Ship* ship, Input input, int shooter);
+static void TakeDamage(Game* g, Ship* ship, int* immune);
+static void WinGame(Game* g);
+static void LoseGame(Game* g);
+static void Emit(Game* g, EventType type, float x, float y, int arg);
+
+// ---
+
+// Roda apenas uma vez pra inicializar a simulacao, retorna 0 se nao tiver memoria pra arena
+int SimInit(Game* g, uint64_t seed) {
+  *g = (Game) { .rng = seed ? seed : 1, .difficulty = DEFAULT_DIFFICULTY };
+  g->player_bullets    = PLAYER_BULLETS;
+  g->player_fire_delay = PLAYER_FIRE_DELAY;
+
+  g->borders[0] = (Rectangle) { 0, -30, WINDOW_WIDTH, 30 };           // Up
+  g->borders[1] = (Rectangle) { 0, WINDOW_HEIGHT, WINDOW_WIDTH, 30 }; // Bottom
+  g->borders[2] = (Rectangle) { -30, 0, 30, WINDOW_HEIGHT };          // Left
+  g->borders[3] = (Rectangle) { WINDOW_WIDTH, 0, 30, WINDOW_HEIGHT }; // Right
+  return ArenaInit(&g->arena, SIM_ARENA_SIZE);
+}
+
+void SimFree(Game* g) {
+  ArenaFree(&g->arena);
+}
+
+// Zera a partida, chamado toda vez que se entra no menu principal
+void SimNewRun(Game* g) {
+  g->player.pos = (Rectangle) { WINDOW_WIDTH / 2.0 - SHIP_WIDTH / 2.0, WINDOW_HEIGHT - SHIP_HEIGHT - 30, SHIP_WIDTH, SHIP_HEIGHT };
+  // No coop cada um comeca num terco da tela
+  if (g->coop) {
+    g->player.pos.x  = WINDOW_WIDTH / 3.0 - SHIP_WIDTH / 2.0;
+    g->partner.pos   = g->player.pos;
+    g->partner.pos.x = WINDOW_WIDTH * 2 / 3.0 - SHIP_WIDTH / 2.0;
+  }
+  g->winner = 0;
+  g->pts    = 0;
+  g->level  = 0;
+}
+
+// Inicio de cada round
+void SimStartRound(Game* g) {
+  g->level++;
+  g->over = 0;
+  g->player.pos.y  = WINDOW_HEIGHT - SHIP_HEIGHT - 30;
+  g->player.shooting = 0;
+  g->player.next_shoot = 0;
+  g->player.dx = 0;
+  g->bullets.count = 0;
+  g->player_immune = 0;
+  g->enemy_direction = 1;
+  g->player.hp = g->difficulty.player_hp[g->mode];
+  g->num_events = 0;
+  if (g->coop) {
+    g->partner.pos.y = g->player.pos.y;
+    g->partner.shooting = 0;
+    g->partner.next_shoot = 0;
+    g->partner.dx = 0;
+    g->partner.hp = g->player.hp;
+    g->partner_immune = 0;
+  }
+
+  GenerateMap(g);
+}
+
+// Avanca a partida em um passo fixo de 1 / TICK_RATE segundos
+void SimTick(Game* g, Input input) {
+  g->num_events = 0;
+  if (g->over) return;
+  g->tick++;
+
+  if (SimTimeLeft(g) < 0) LoseGame(g); // Faz o player perder o jogo caso alcance o tempo limite
+  if (input & IN_WIN)  WinGame(g);
+  if (input & IN_LOSE) LoseGame(g);
+  if (g->over) return;
+
+  // Decrementa os frames de imunidade se o player estiver imune
+  if (g->player_immune) g->player_immune--;
+  if (g->partner_immune) g->partner_immune--;
+
+  EnemiesMovement(g);
+  PlayerMovement(g, input);
+  EnemyShoot(g);
+  PlayerShoot(g, input);
+  BulletsCollision(g);
+}
+
+// --- Funcoes do jogo
+
+void GenerateMap(Game* g) {
+  g->timer = MAX(80, 100 - (g->level * 5));
+  g->start_tick = g->tick;
+
+  Difficulty* d = &g->difficulty;
+  double ramp = MIN(d->ramp_max, g->level * d->ramp);
+  g->enemy_bullet_speed = d->enemy_bullet_speed[g->mode] * (1 + ramp);
+  g->enemy_shoot_timer  = d->enemy_shoot_timer[g->mode]  * (1 - ramp);
+  g->enemy_speed        = d->enemy_speed[g->mode]        * (1 + ramp);
+
+  int columns = MIN(7 + ((g->level - 1) / 2), MAX_COLUMNS);
+  int lines   = MIN(4 + (g->level < 5 ? 0 : ((g->level - 6) / 2)), MAX_LINES);
+
+  // Enxame: cresce rapido a cada level ate o limite
+  g->swarm = SWARM_MODE && g->level >= SWARM_LEVEL;
+  if (g->swarm) {
+    columns = MIN(MAX_COLUMNS + (g->level - SWARM_LEVEL + 1) * 12, SWARM_MAX_COLUMNS);
+    lines   = MIN(MAX_LINES   + (g->level - SWARM_LEVEL + 1) * 4,  SWARM_MAX_LINES);
+  }
+
+  ArenaReset(&g->arena);
+  InitFormation(g, columns, lines);
+
+  InitBarriers(g);
+}
+
+// A forma vem da mascara do sprite; sem as imagens e o quadrado cheio
+void InitBarriers(Game* g) {
+  int hits = g->difficulty.barrier_hp[g->mode];
+  for (int i = 0; i < LEN(g->barriers); i++) {
+    Barrier* b = &g->barriers[i];
+    b->pos = (Rectangle) { (i + 1) * ((float) WINDOW_WIDTH / ((int)LEN(g->barriers) + 1)), 400, SHIP_WIDTH, SHIP_HEIGHT };
+    b->bite = (SPRITE_SIZE + hits - 1) / hits;
+    b->hp = 0;
+    for (int r = 0; r < SPRITE_SIZE; r++) {
+      b->pixels.rows[r] = g->masks ? g->masks->barrier.rows[r] : ~0u;
+      b->hp += __builtin_popcount(b->pixels.rows[r]);
+    }
+    b->max_hp = b->hp;
+  }
+}
+
+// Formacao cheia de columns x lines, todos vivos, tirando os arrays da arena do round
+// A grade encolhe pra caber na tela; retorna 0 e deixa a formacao vazia se nao couber na arena
+int InitFormation(Game* g, int columns, int lines) {
+  Formation* f = &g->enemies;
+  int count = columns * lines;
+  f->x            = ArenaPush(&g->arena, count * sizeof(*f->x));
+  f->y            = ArenaPush(&g->arena, count * sizeof(*f->y));
+  f->next_shoot   = ArenaPush(&g->arena, count * sizeof(*f->next_shoot));
+  f->alive        = ArenaPush(&g->arena, count * sizeof(*f->alive));
+  f->shooting     = ArenaPush(&g->arena, count * sizeof(*f->shooting));
+  f->column_count = ArenaPush(&g->arena, columns * sizeof(*f->column_count));
+  f->bottom       = ArenaPush(&g->arena, columns * sizeof(*f->bottom));
+  f->line_count   = ArenaPush(&g->arena, lines * sizeof(*f->line_count));
+  int ok = f->x && f->y && f->next_shoot && f->alive && f->shooting && f->column_count && f->bottom && f->line_count;
+
+  f->columns = ok ? columns : 0;
+  f->lines   = ok ? lines : 0;
+  f->count   = f->columns * f->lines;
+  f->spacing = MIN(ENEMY_SPACING, MIN(720.0 / MAX(1, columns), 360.0 / MAX(1, lines)));
+  f->size    = SHIP_WIDTH * f->spacing / ENEMY_SPACING;
+  f->dx      = 0;
+
+  for (int i = 0; i < f->columns; i++) {
+    for (int j = 0; j < f->lines; j++) {
+      int k = i * f->lines + j;
+      f->alive[k] = 1;
+      f->shooting[k] = 0;
+      f->next_shoot[k] = g->tick + SimRandom(g, 1, 5 * ShootScale(f)) * TICK_RATE;
+      f->x[k] = i * f->spacing;
+      f->y[k] = 15 + j * f->spacing;
+    }
+  }
+  IndexFormation(f);
+  return ok;
+}
+
+void PlayerMovement(Game* g, Input input) {
+  MoveShip(g, &g->player, input);
+  if (g->coop) MoveShip(g, &g->partner, PARTNER_INPUT(input));
+}
+
+void EnemiesMovement(Game* g) {
+  Formation* f = &g->enemies;
+
+  f->dx = 0;
+  if (!f->alive_count) return;
+
+  // A coluna inteira anda junto, entao so as colunas das pontas da caixa importam
+  float lo = f->x[f->first_column * f->lines], hi = f->x[f->last_column * f->lines];
+  if      (lo < g->borders[2].x + g->borders[2].width) g->enemy_direction =  1;
+  else if (hi + f->size > g->borders[3].x)            g->enemy_direction = -1;
+
+  float dx = f->dx = g->enemy_speed * g->enemy_direction;
+  for (int k = 0; k < f->count; k++)
+    f->x[k] += dx;
+}
+
+void EnemyShoot(Game* g) {
+  Formation* f = &g->enemies;
+  for (int i = f->first_column; i <= f->last_column; i++) {
+    // So o mais baixo de cada coluna atira, a nao ser no ALL_ENEMIES_SHOOT
+    int top = ALL_ENEMIES_SHOOT ? 0 : f->bottom[i];
+    for (int j = top; j >= 0 && j <= f->bottom[i]; j++) {
+      int k = i * f->lines + j;
+
+      // Atira se o inimigo estiver vivo, no tempo e sem tiro no ar
+      if (f->shooting[k] || g->tick < f->next_shoot[k] || !f->alive[k]) continue;
+      float x = f->x[k] + f->size / 2;
+      float y = f->y[k] + f->size / 2;
+      if (!SpawnBullet(g, x, y, g->enemy_bullet_speed, OWNER_ENEMY, k)) return;
+      f->shooting[k] = 1;
+      f->next_shoot[k] = g->tick + g->enemy_shoot_timer * ShootScale(f) * TICK_RATE;
+      Emit(g, EV_ENEMY_SHOOT, x, y, 0);
+    }
+  }
+}
+
+void PlayerShoot(Game* g, Input input) {
+  ShipShoot(g, &g->player, input, -1);
+  if (g->coop) ShipShoot(g, &g->partner, PARTNER_INPUT(input), -2);
+}
+
+// Uma passada so por tick: cada tiro vivo varre o caminho do passo uma vez e depois todos andam
+// Naves e inimigos ja andaram nesse tick; o teste volta eles pro comeco e usa a velocidade relativa
+// Naves e barreiras vao numa grade montada aqui; a formacao ja e uma grade uniforme e e consultada direto
+void BulletsCollision(Game* g) {
+  Bullets* b = &g->bullets;
+  if (!b->count) return;
+
+  CollideGrid grid;
+  GridClear(&grid);
+  Ship* ships[] = { &g->player, &g->partner };
+  for (int s = 0; s < (g->coop ? 2 : 1); s++) {
+    Rectangle start = ships[s]->pos;
+    start.x -= ships[s]->dx;
+    if (ships[s]->hp) GridInsert(&grid, start, ships[s]->dx, 0, BODY_PLAYER + s);
+  }
+  for (int a = 0; a < LEN(g->barriers); a++)
+    if (g->barriers[a].hp) GridInsert(&grid, g->barriers[a].pos, 0, 0, BODY_BARRIER + a);
+
+  for (int n = 0; n < b->count && !g->over;) {
+    int hit = b->owner[n] == OWNER_PLAYER ? PlayerBulletHit(g, &grid, n) : EnemyBulletHit(g, &grid, n);
+    if (hit) RemoveBullet(g, n);
+    else n++;
+  }
+
+  for (int n = 0; n < b->count; n++)
+    b->y[n] += b->vy[n];
+}
+
+// Primeira nave ou barreira no caminho do tiro; sem nenhuma, ve se ele saiu pela borda de baixo
+static int EnemyBulletHit(Game* g, CollideGrid* grid, int n) {
+  Rectangle bullet = BulletRec(&g->bullets, n);
+  float dy = g->bullets.vy[n], t = COLLIDE_MISS;
+  int id = FirstBody(g, grid, bullet, dy, BODY_PLAYER, &t);
+  if (id < 0) return SweepRecs(bullet, 0, dy, g->borders[1]) < COLLIDE_MISS;
+
+  if (id == BODY_PLAYER)  TakeDamage(g, &g->player, &g->player_immune);
+  if (id == BODY_PARTNER) TakeDamage(g, &g->partner, &g->partner_immune);
+  if (id >= BODY_BARRIER) HitBarrier(g, id - BODY_BARRIER, bullet, dy, t);
+  return 1;
+}
+
+// O tiro para na primeira barreira ou no teto; os inimigos antes disso (ou no mesmo instante) sao atingidos
+// No enxame ele mata todos no caminho, senao so o primeiro; se nao acertou nenhum, a barreira e lascada
+static int PlayerBulletHit(Game* g, CollideGrid* grid, int n) {
+  Rectangle bullet = BulletRec(&g->bullets, n), path;
+  float dy = g->bullets.vy[n], stop = COLLIDE_MISS, top;
+  int barrier = FirstBody(g, grid, bullet, dy, BODY_BARRIER, &stop);
+  if ((top = SweepRecs(bullet, 0, dy, g->borders[0])) < stop) stop = top, barrier = -1;
+
+  // Descarta logo o que estiver fora da caixa dos vivos e so testa as celulas da formacao embaixo do caminho
+  // Tudo na posicao da formacao no comeco do tick, com o tiro andando relativo a ela
+  Formation* f = &g->enemies;
+  Rectangle box = FormationRec(f);
+  box.x -= f->dx;
+  path = SweptRec(bullet, -f->dx, dy);
+  if (f->alive_count && RecsOverlap(box, path)) {
+    const SpriteMask* mask = g->masks ? &g->masks->enemy[EnemyFrame(g)] : NULL;
+    int i0, i1, j0, j1, target = -1;
+    float first = COLLIDE_MISS;
+    CellRange(f->x[0] - f->dx, f->y[0], f->spacing, f->size, path, &i0, &i1, &j0, &j1);
+
+    for (int i = MAX(f->first_column, i0); i <= MIN(f->last_column, i1); i++) {
+      for (int j = MAX(f->first_line, j0); j <= MIN(MIN(f->last_line, j1), f->bottom[i]); j++) {
+        int k = i * f->lines + j;
+        float t;
+        Rectangle enemy = EnemyRec(f, k);
+        enemy.x -= f->dx;
+        if (!f->alive[k] || (t = SweepRecs(bullet, -f->dx, dy, enemy)) == COLLIDE_MISS || t > stop) continue;
+        if (mask && (t = SweepMask(bullet, -f->dx, dy, enemy, mask, t)) > stop) continue;
+        if (!g->swarm) {
+          if (t < first) target = k, first = t;
+          continue;
+        }
+        KillEnemy(g, k);
+        if (!f->alive_count) {
+          WinGame(g);
+          return 1;
+        }
+      }
+    }
+
+    if (target >= 0) {
+      KillEnemy(g, target);
+      if (!f->alive_count) WinGame(g);
+      return 1;
+    }
+  }
+  if (barrier >= 0) HitBarrier(g, barrier - BODY_BARRIER, bullet, dy, stop);
+  return stop < COLLIDE_MISS;
+}
+
+// Tiro que encostou na barreira no instante t do passo
+static void HitBarrier(Game* g, int a, Rectangle bullet, float dy, float t) {
+  Barrier* barrier = &g->barriers[a];
+  bullet.y += dy * t;
+  barrier->hp -= ChipBarrier(barrier, bullet, dy);
+  Emit(g, barrier->hp ? EV_BARRIER_HIT : EV_BARRIER_BREAK, bullet.x, bullet.y, a);
+}
+
+// Corpo vivo com id >= first_id que o tiro encosta primeiro no passo; -1 se nenhum
+// A grade e do comeco do tick, entao o hp e conferido de novo aqui
+static int FirstBody(Game* g, CollideGrid* grid, Rectangle bullet, float dy, int first_id, float* toi) {
+  int found[COLLIDE_BODIES], best = -1;
+  int count = GridQuery(grid, SweptRec(bullet, 0, dy), found, LEN(found));
+  for (int i = 0; i < count; i++) {
+    CollideBody* body = &grid->bodies[found[i]];
+    int hp = body->id == BODY_PLAYER ? g->player.hp : body->id == BODY_PARTNER ? g->partner.hp : g->barriers[body->id - BODY_BARRIER].hp;
+    if (body->id < first_id || !hp) continue;
+    // Barreira so nos pixels que sobraram; nave nos do sprite que esta sendo desenhado, que muda com o hp
+    const SpriteMask* mask = body->id >= BODY_BARRIER ? &g->barriers[body->id - BODY_BARRIER].pixels
+                           : g->masks ? &g->masks->player[MAX(0, 3 - hp)] : NULL;
+    float t = SweepRecs(bullet, -body->dx, dy - body->dy, body->rec);
+    if (mask) t = SweepMask(bullet, -body->dx, dy - body->dy, body->rec, mask, t);
+    if (t < *toi || (t == *toi && t < COLLIDE_MISS && body->id < best)) {
+      *toi = t;
+      best = body->id;
+    }
+  }
+  return best;
+}
+
+// Pega um slot da lista livre, retorna 0 se o pool estiver cheio
+static int SpawnBullet(Game* g, float x, float y, float vy, BulletOwner owner, int shooter) {
+  Bullets* b = &g->bullets;
+  if (b->count == MAX_BULLETS) return 0;
+  int n = b->count++;
+  b->x[n] = x;
+  b->y[n] = y;
+  b->vy[n] = vy;
+  b->owner[n] = owner;
+  b->shooter[n] = shooter;
+  return 1;
+}
+
+// Devolve o tiro pro pool trazendo o ultimo vivo pro lugar dele
+static void RemoveBullet(Game* g, int n) {
+  Bullets* b = &g->bullets;
+  if (b->owner[n] == OWNER_PLAYER) (b->shooter[n] == -2 ? &g->partner : &g->player)->shooting--;
+  else g->enemies.shooting[b->shooter[n]] = 0;
+
+  int last = --b->count;
+  b->x[n] = b->x[last];
+  b->y[n] = b->y[last];
+  b->vy[n] = b->vy[last];
+  b->owner[n] = b->owner[last];
+  b->shooter[n] = b->shooter[last];
+}
+
+// Monta o indice de ocupacao do zero, so no inicio do round
+static void IndexFormation(Formation* f) {
+  f->alive_count = 0;
+  f->first_column = f->columns;
+  f->first_line   = f->lines;
+  f->last_column  = f->last_line  = -1;
+  for (int j = 0; j < f->lines; j++) f->line_count[j] = 0;
+
+  for (int i = 0; i < f->columns; i++) {
+    f->column_count[i] = 0;
+    f->bottom[i] = -1;
+    for (int j = 0; j < f->lines; j++) {
+      if (!f->alive[i * f->lines + j]) continue;
+      f->alive_count++;
+      f->column_count[i]++;
+      f->line_count[j]++;
+      f->bottom[i] = j;
+      f->first_column = MIN(f->first_column, i);
+      f->last_column  = MAX(f->last_column, i);
+      f->first_line   = MIN(f->first_line, j);
+      f->last_line    = MAX(f->last_line, j);
+    }
+  }
+}
+
+// Formacoes mais largas que a normal atiram mais devagar por coluna, pra chuva de tiros ficar parecida
+static int ShootScale(Formation* f) {
+  return MAX(1, f->columns / MAX_COLUMNS);
+}
+
+// Mata o inimigo e atualiza o indice; as pontas da caixa so andam pra dentro
+static void KillEnemy(Game* g, int k) {
+  Formation* f = &g->enemies;
+  int i = k / f->lines, j = k % f->lines;
+  f->alive[k] = 0;
+  f->alive_count--;
+  f->column_count[i]--;
+  f->line_count[j]--;
+  g->pts += 5;
+  Emit(g, EV_ENEMY_KILLED, f->x[k], f->y[k], 0);
+
+  if (f->bottom[i] == j)
+    while (f->bottom[i] >= 0 && !f->alive[i * f->lines + f->bottom[i]]) f->bottom[i]--;
+
+  if (!f->alive_count) return;
+  while (!f->column_count[f->first_column]) f->first_column++;
+  while (!f->column_count[f->last_column])  f->last_column--;
+  while (!f->line_count[f->first_line])     f->first_line++;
+  while (!f->line_count[f->last_line])      f->last_line--;
+}
+
+// Arranca ate bite pixels de cada coluna embaixo do tiro, a partir do lado de onde ele veio, e retorna quantos
+// O caminho ate o contato nao tinha pixel nessas colunas, entao comecar da borda da barreira da no mesmo
+static int ChipBarrier(Barrier* b, Rectangle bullet, float dy) {
+  float sx = SPRITE_SIZE / b->pos.width;
+  int c0 = MAX(0, (int) floorf((bullet.x - b->pos.x) * sx));
+  int c1 = MIN(SPRITE_SIZE - 1, (int) ceilf((bullet.x + bullet.width - b->pos.x) * sx) - 1);
+  if (c0 > c1) return 0;
+
+  int left[SPRITE_SIZE], removed = 0;
+  uint32_t want = ((2u << c1) - 1) & ~((1u << c0) - 1); // Colunas que ainda podem perder pixel
+  for (int c = c0; c <= c1; c++) left[c] = b->bite;
+  for (int n = 0; n < SPRITE_SIZE && want; n++) {
+    int r = dy < 0 ? SPRITE_SIZE - 1 - n : n;
+    uint32_t hit = b->pixels.rows[r] & want;
+    b->pixels.rows[r] &= ~hit;
+    removed += __builtin_popcount(hit);
+    for (; hit; hit &= hit - 1) {
+      int c = __builtin_ctz(hit);
+      if (!--left[c]) want &= ~(1u << c);
+    }
+  }
+  return removed;
+}
+
+// --- Naves dos jogadores; uma nave sem hp (so no coop) fica parada e os tiros passam por ela
+
+static void MoveShip(Game* g, Ship* ship, Input input) {
+  float x = ship->pos.x;
+  if (ship->hp && (input & IN_RIGHT) && !RecsOverlap(ship->pos, g->borders[3])) ship->pos.x += 5;
+  if (ship->hp && (input & IN_LEFT)  && !RecsOverlap(ship->pos, g->borders[2])) ship->pos.x -= 5;
+  ship->dx = ship->pos.x - x;
+}
+
+// shooter -1 e o player e -2 o parceiro, pro RemoveBullet devolver o tiro certo
+static void ShipShoot(Game* g, Ship* ship, Input input, int shooter) {
+  if (!ship->hp || !(input & IN_SHOOT) || ship->shooting >= g->player_bullets || g->tick < ship->next_shoot) return;
+  float x = ship->pos.x + ship->pos.width  / 2 - BULLET_WIDTH  / 2.0;
+  float y = ship->pos.y + ship->pos.height / 2 - BULLET_HEIGHT / 2.0;
+  if (!SpawnBullet(g, x, y, -PLAYER_BULLET_SPEED, OWNER_PLAYER, shooter)) return;
+  ship->shooting++;
+  ship->next_shoot = g->tick + g->player_fire_delay;
+  Emit(g, EV_PLAYER_SHOOT, x, y, 0);
+}
+
+// Reduz o HP e finaliza a partida quando nao sobra nenhuma nave
+static void TakeDamage(Game* g, Ship* ship, int* immune) {
+  if (*immune || g->over) return;
+  *immune = 30;
+  Emit(g, EV_PLAYER_DAMAGE, ship->pos.x, ship->pos.y, --ship->hp);
+  if (!g->player.hp && (!g->coop || !g->partner.hp)) LoseGame(g);
+}
+
+// Finaliza o round com vitoria
+static void WinGame(Game* g) {
+  if (g->over) return;
+  g->over = 1;
+  g->over_tick = g->tick;
+  g->winner = 1;
+  g->pts += 100 * (g->mode + 1);
+  Emit(g, EV_WIN, g->player.pos.x, g->player.pos.y, 0);
+}
+
+// Finaliza o round com derrota
+static void LoseGame(Game* g) {
+  if (g->over) return;
+  g->over = 1;
+  g->over_tick = g->tick;
+  g->winner = 0;
+  Emit(g, EV_LOSE, g->player.pos.x, g->player.pos.y, 0);
+}
+
+// Guarda o evento pra camada de apresentacao tocar sons e efeitos
+static void Emit(Game* g, EventType type, float x, float y, int arg) {
+  if (g->num_events == MAX_EVENTS) return;
+  g->events[g->num_events++] = (Event) { type, x, y, arg };
+}
+
+// Utils
+
+// Ticks restantes do round, negativo quando o tempo estourou
+int SimTimeLeft(Game* g) {
+  return g->timer * TICK_RATE - (g->tick - g->start_tick);
+}
+
+// xorshift64*, deterministico e sem depender do raylib
+int SimRandom(Game* g, int min, int max) {
+  g->rng ^= g->rng >> 12;
+  g->rng ^= g->rng << 25;
+  g->rng ^= g->rng >> 27;
+  uint64_t x = g->rng * 0x2545F4914F6CDD1DULL;
+  return min + (int) ((x >> 32) % (uint64_t) (max - min + 1));
+}
+
+int RecsOverlap(Rectangle a, Rectangle b) {
+  return a.x < b.x + b.width && a.x + a.width > b.x && a.y < b.y + b.height && a.y + a.height > b.y;
+}
+
+Rectangle EnemyRec(Formation* f, int k) {
+  return (Rectangle) { f->x[k], f->y[k], f->size, f->size };
+}
+
+// Caixa que envolve todos os inimigos vivos
+Rectangle FormationRec(Formation* f) {
+  float x0 = f->x[f->first_column * f->lines], x1 = f->x[f->last_column * f->lines];
+  float y0 = f->y[f->first_line], y1 = f->y[f->last_line];
+  return (Rectangle) { x0, y0, x1 - x0 + f->size, y1 - y0 + f->size };
+}
+
+Rectangle BulletRec(Bullets* b, int n) {
+  return (Rectangle) { b->x[n], b->y[n], BULLET_WIDTH, BULLET_HEIGHT };
+}
+
+// Frame da animacao dos inimigos, troca a cada segundo de jogo; a colisao usa a mascara do mesmo frame
+int EnemyFrame(Game* g) {
+  return g->tick / TICK_RATE % 2;
+}
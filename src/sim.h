@@ -0,0 +1,199 @@
+#ifndef SIM_H
+#define SIM_H
+
+// Regras do jogo sem janela, audio nem GPU
+// Quem desenha le o estado e os eventos emitidos a cada tick
+
+#include "clock.h"
+#include "arena.h"
+#include <stdint.h>
+
+#define MIN(x, y) (x < y ? x : y)
+#define MAX(x, y) (x < y ? y : x)
+#define LEN(x)    (sizeof(x) / sizeof(x[0]))
+
+#define WINDOW_WIDTH  800
+#define WINDOW_HEIGHT 600
+#define BULLET_WIDTH  10
+#define BULLET_HEIGHT 10
+#define PLAYER_BULLET_SPEED 15 // Pixels por tick, pra cima
+#define SHIP_WIDTH    32
+#define SHIP_HEIGHT   32
+#define SPRITE_SIZE   32 // Lado dos sprites das naves em pixels; uma linha da mascara cabe num uint32_t
+
+// O limite de tiros pode vir de fora (-D) pra montar cenarios maiores no bench
+#define MAX_EVENTS  64
+#define MAX_COLUMNS 12
+#define MAX_LINES   6
+#ifndef MAX_BULLETS
+#define MAX_BULLETS 1024
+#endif
+
+#define ENEMY_SPACING  60         // Distancia entre inimigos na formacao normal
+#define SIM_ARENA_SIZE (1 << 20)  // Memoria do round, cabe a maior formacao do enxame com folga
+
+// A partir do SWARM_LEVEL a formacao cresce ate milhares de inimigos menores, e o tiro do player atravessa
+#define SWARM_MODE        1
+#define SWARM_LEVEL       10
+#define SWARM_MAX_COLUMNS 96
+#define SWARM_MAX_LINES   32
+
+#define PLAYER_BULLETS    1 // Tiros do player no ar ao mesmo tempo
+#define PLAYER_FIRE_DELAY 0 // Ticks minimos entre tiros do player
+
+#define ALL_ENEMIES_SHOOT 0
+
+// No coop as teclas do segundo jogador vem nos bits de cima do Input; replays sao so de um jogador
+#define PARTNER_SHIFT 5
+#define PARTNER_INPUT(input) ((input) >> PARTNER_SHIFT & (IN_LEFT | IN_RIGHT | IN_SHOOT))
+
+// Mesmo layout do Rectangle do raylib, pra nao depender dele no headless
+#ifndef RAYLIB_H
+typedef struct Rectangle {
+  float x, y, width, height;
+} Rectangle;
+#endif
+
+// ---
+
+typedef enum {
+  NORMAL, HARD, HARDCORE
+} Mode;
+
+// Teclas do jogador num tick
+typedef enum {
+  IN_LEFT  = 1 << 0,
+  IN_RIGHT = 1 << 1,
+  IN_SHOOT = 1 << 2,
+  IN_WIN   = 1 << 3, // Atalho F2
+  IN_LOSE  = 1 << 4  // Atalho F3
+} InputKey;
+
+typedef uint8_t Input;
+
+typedef enum {
+  EV_PLAYER_SHOOT, EV_ENEMY_SHOOT, EV_ENEMY_KILLED,
+  EV_BARRIER_HIT, EV_BARRIER_BREAK, EV_PLAYER_DAMAGE,
+  EV_WIN, EV_LOSE
+} EventType;
+
+typedef struct {
+  EventType type;
+  float x, y;
+  int arg;
+} Event;
+
+typedef enum {
+  OWNER_PLAYER, OWNER_ENEMY
+} BulletOwner;
+
+typedef struct {
+  Rectangle pos;
+  int hp, shooting; // shooting = tiros no ar
+  float dx; // Quanto andou no ultimo tick, pra colisao varrida
+  int64_t next_shoot;
+} Ship;
+
+// Pixels opacos de um sprite, bit i da linha = coluna i; esticada sobre o retangulo de quem desenha
+typedef struct {
+  uint32_t rows[SPRITE_SIZE];
+} SpriteMask;
+
+// Mesmos indices dos sprites: player[3 - hp] e enemy[EnemyFrame]; barrier e a forma inteira, antes de apanhar
+typedef struct {
+  SpriteMask player[3], enemy[2], barrier;
+} SpriteMasks;
+
+// hp = pixels que ainda restam; cada tiro inimigo arranca ate bite pixels de cada coluna embaixo dele
+typedef struct {
+  Rectangle pos;
+  int max_hp, hp, bite;
+  SpriteMask pixels;
+} Barrier;
+
+// Constantes de cada modo (NORMAL, HARD, HARDCORE); o GenerateMap soma a rampa por level
+typedef struct {
+  float enemy_speed[3], enemy_bullet_speed[3];
+  float enemy_shoot_timer[3]; // Segundos entre tiros de um inimigo, truncado depois da rampa
+  int barrier_hp[3], player_hp[3]; // barrier_hp = tiros no mesmo lugar pra furar a barreira
+  double ramp, ramp_max; // Cada level deixa o modo ramp mais dificil, ate ramp_max
+} Difficulty;
+
+#define DEFAULT_DIFFICULTY (Difficulty) { { 3, 4.5, 6 }, { 5, 6, 7 }, { 4, 3, 2 }, { 5, 8, 10 }, { 3, 2, 1 }, 0.1, 0.2 }
+
+// Formacao em struct-of-arrays, indice = coluna * lines + linha
+// Cada coluna fica contigua, de cima pra baixo; os arrays vem da arena do round
+typedef struct {
+  int columns, lines, count;
+  float spacing, size; // Grade uniforme: distancia entre inimigos e lado do sprite
+  float dx; // Quanto a formacao andou no ultimo tick
+  float* x, * y;
+  int64_t* next_shoot;
+  uint8_t* alive, * shooting;
+
+  // Indice de ocupacao, so muda quando um inimigo morre
+  int alive_count;
+  int* column_count, * line_count;
+  int* bottom; // Linha do inimigo vivo mais baixo da coluna, -1 se vazia
+  int first_column, last_column, first_line, last_line; // Caixa dos vivos
+} Formation;
+
+// Pool unico de tiros do player e dos inimigos
+// Os vivos ficam densos em [0, count) e o resto e a lista livre; remover troca com o ultimo
+typedef struct {
+  int count;
+  float x[MAX_BULLETS], y[MAX_BULLETS], vy[MAX_BULLETS];
+  int16_t shooter[MAX_BULLETS]; // Indice do inimigo na formacao, -1 pro player
+  uint8_t owner[MAX_BULLETS];
+} Bullets;
+
+typedef struct {
+  Ship player;
+  Formation enemies;
+  Bullets bullets;
+  Rectangle borders[4];
+  Barrier barriers[4];
+  Mode mode;
+  Difficulty difficulty;
+  float enemy_speed, enemy_bullet_speed;
+  int winner, over, pts, timer, level;
+  int enemy_shoot_timer;
+  int player_bullets, player_fire_delay;
+  int enemy_direction, player_immune;
+  int swarm; // Tiro do player atravessa os inimigos
+  int coop;  // Segundo jogador; o round so e perdido quando os dois morrem
+  Ship partner;
+  int partner_immune;
+  int64_t over_tick; // Tick em que o round acabou
+  const SpriteMasks* masks; // Colisao por pixel; NULL usa o retangulo inteiro (headless, sem as imagens)
+  int64_t tick, start_tick;
+  Arena arena; // Zerada no GenerateMap
+  uint64_t rng;
+  Event events[MAX_EVENTS];
+  int num_events;
+} Game;
+
+// ---
+
+int  SimInit(Game* g, uint64_t seed);
+void SimFree(Game* g);
+void SimNewRun(Game* g);
+void SimStartRound(Game* g);
+void SimTick(Game* g, Input input);
+int  SimTimeLeft(Game* g);
+void GenerateMap(Game* g);
+int  InitFormation(Game* g, int columns, int lines);
+void InitBarriers(Game* g);
+void EnemiesMovement(Game* g);
+void PlayerMovement(Game* g, Input input);
+void EnemyShoot(Game* g);
+void PlayerShoot(Game* g, Input input);
+void BulletsCollision(Game* g);
+int  SimRandom(Game* g, int min, int max);
+int  RecsOverlap(Rectangle a, Rectangle b);
+Rectangle EnemyRec(Formation* f, int k);
+Rectangle FormationRec(Formation* f);
+Rectangle BulletRec(Bullets* b, int n);
+int  EnemyFrame(Game* g);
+
+#endif
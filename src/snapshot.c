@@ -0,0 +1,64 @@
+#include "snapshot.h"
+#include <string.h>
+
+void TripleInit(TripleBuffer* t) {
+  atomic_store(&t->middle, 0);
+  t->back  = 1;
+  t->front = 2;
+}
+
+Snapshot* TripleBack(TripleBuffer* t) {
+  return &t->slots[t->back];
+}
+
+// Troca o back pronto pelo do meio; se o leitor nao pegou o antigo do meio ele so e reaproveitado
+void TriplePublish(TripleBuffer* t) {
+  t->back = atomic_exchange_explicit(&t->middle, t->back | SNAPSHOT_FRESH, memory_order_acq_rel) & ~SNAPSHOT_FRESH;
+}
+
+// Pega o do meio se tiver um novo, senao continua com o mesmo
+Snapshot* TripleLatest(TripleBuffer* t) {
+  if (atomic_load_explicit(&t->middle, memory_order_relaxed) & SNAPSHOT_FRESH)
+    t->front = atomic_exchange_explicit(&t->middle, t->front, memory_order_acq_rel) & ~SNAPSHOT_FRESH;
+  return &t->slots[t->front];
+}
+
+void SnapshotTake(Snapshot* s, Game* g, float prev_player_x, float prev_formation_x, uint64_t time) {
+  s->game = *g;
+  Formation* f = &s->game.enemies;
+  int count = MIN(f->count, SNAPSHOT_ENEMIES);
+  memcpy(s->x, g->enemies.x, count * sizeof(float));
+  memcpy(s->y, g->enemies.y, count * sizeof(float));
+  memcpy(s->alive, g->enemies.alive, count);
+  f->count = count;
+  f->x = s->x;
+  f->y = s->y;
+  f->alive = s->alive;
+  f->next_shoot = NULL;
+  f->shooting = NULL;
+  f->column_count = f->line_count = f->bottom = NULL;
+  s->game.arena = (Arena) { 0 };
+
+  s->prev_player_x = prev_player_x;
+  s->prev_formation_x = prev_formation_x;
+  s->time = time;
+}
+
+// Retorna quantos couberam; o resto e contado em dropped
+int EventQueuePush(EventQueue* q, Event* events, int n) {
+  uint32_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&q->head, memory_order_acquire);
+  int room = EVENT_QUEUE_SIZE - (tail - head), pushed = MIN(n, room);
+  for (int i = 0; i < pushed; i++) q->items[(tail + i) & (EVENT_QUEUE_SIZE - 1)] = events[i];
+  atomic_store_explicit(&q->tail, tail + pushed, memory_order_release);
+  if (pushed < n) atomic_fetch_add(&q->dropped, n - pushed);
+  return pushed;
+}
+
+int EventQueuePop(EventQueue* q, Event* e) {
+  uint32_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+  if (head == atomic_load_explicit(&q->tail, memory_order_acquire)) return 0;
+  *e = q->items[head & (EVENT_QUEUE_SIZE - 1)];
+  atomic_store_explicit(&q->head, head + 1, memory_order_release);
+  return 1;
+}
@@ -0,0 +1,47 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// Passagem de estado da thread da simulacao pra de desenho
+// Snapshots imutaveis num triple buffer lock-free: quem escreve nunca espera e quem le sempre pega o mais novo
+// Os eventos nao podem ser pulados, entao vao numa fila de um produtor e um consumidor
+
+#include "sim.h"
+#include <stdatomic.h>
+
+#define SNAPSHOT_ENEMIES (SWARM_MAX_COLUMNS * SWARM_MAX_LINES)
+#define SNAPSHOT_FRESH   4 // Bit do middle: publicado e ainda nao lido
+#define EVENT_QUEUE_SIZE 4096 // Potencia de 2
+
+// Copia do jogo pra desenhar; so x, y e alive da formacao existem, os outros ponteiros sao NULL
+typedef struct {
+  Game game;
+  float x[SNAPSHOT_ENEMIES], y[SNAPSHOT_ENEMIES];
+  uint8_t alive[SNAPSHOT_ENEMIES];
+  float prev_player_x, prev_formation_x; // Antes do ultimo tick, pra interpolar
+  uint64_t time; // Quando o ultimo tick rodou
+} Snapshot;
+
+typedef struct {
+  Snapshot slots[3];
+  _Atomic int middle; // Indice do ultimo publicado, com SNAPSHOT_FRESH
+  int back, front;    // back e de quem escreve, front de quem le
+} TripleBuffer;
+
+typedef struct {
+  Event items[EVENT_QUEUE_SIZE];
+  _Atomic uint32_t head; // So quem le escreve
+  char pad[60];
+  _Atomic uint32_t tail; // So quem escreve escreve
+  char pad2[60];
+  atomic_int dropped;
+} EventQueue;
+
+void      TripleInit(TripleBuffer* t);
+Snapshot* TripleBack(TripleBuffer* t);
+void      TriplePublish(TripleBuffer* t);
+Snapshot* TripleLatest(TripleBuffer* t);
+void      SnapshotTake(Snapshot* s, Game* g, float prev_player_x, float prev_formation_x, uint64_t time);
+int       EventQueuePush(EventQueue* q, Event* events, int n);
+int       EventQueuePop(EventQueue* q, Event* e);
+
+#endif
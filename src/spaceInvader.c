@@ -1,33 +1,57 @@
 #include "raylib.h"
+#include "rlgl.h"
+#include "sim.h"
+#include "draw.h"
+#include "particles.h"
+#include "pack.h"
+#include "scores.h"
+#include "saver.h"
+#include "profile.h"
+#include "replay.h"
+#include "net.h"
+#include "rewind.h"
+#include "mixer.h"
+#include "audio.h"
+#include "text.h"
+#include "snapshot.h"
+#include <stdarg.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <ctype.h>
 #include <math.h>
 
-#define CIRCULAR_CLAMP(x, y, z) ((y < x) ? z : ((y > z) ? x : y))
-#define MIN(x, y) (x < y ? x : y)
-#define MAX(x, y) (x < y ? y : x)
-#define LEN(x)    (sizeof(x) / sizeof(x[0]))
-
-#define WINDOW_WIDTH  800
-#define WINDOW_HEIGHT 600
-#define BULLET_WIDTH  10
-#define BULLET_HEIGHT 10
-#define SHIP_WIDTH    32
-#define SHIP_HEIGHT   32
-
-#define SAVE_PATH "./save.txt"
-#define RANK_PATH "./rank.txt"
+#define SCORES_LOG "./scores.log"
+#define SCORES_IDX "./scores.idx"
+#define SAVE_PATH  "./save.txt" // Formato antigo, so lido pra importar
+#define RANK_PATH  "./rank.txt"
 #define NAME_SIZE 3
 
-#define NUM_STARS  60
-#define STAR_SPEED 0.25
+#define NUM_STARS   60
+#define STAR_LAYERS 3
+#define STAR_SPEED  0.25
 #define BACKGROUND_COLOR (Color) { 10, 0, 10 }
 #define DAMAGE_REDNESS 6
+#define DEBRIS_GRAVITY 0.15
 #define VOLUME 0.5
 
-#define ALL_ENEMIES_SHOOT 0
-#define SPICY_MODE        0
+#define PACK_FILE        "assets.pak"
+#define MAX_LOAD_THREADS 8
+
+#define TRACE_FILE "./profile.json"
+#define REPLAY_DIR "./replays" // Um replay por partida, com o numero do registro no historico
+
+#define ATLAS_SIZE    256
+#define ATLAS_PADDING 2
+
+#define SCRATCH_SIZE (64 << 10) // Strings temporarias do frame
+
+#define SPICY_MODE 0
 
 // ---
 
@@ -35,95 +59,169 @@ typedef enum {
   START_SCREEN, MODE_SCREEN, GAME_SCREEN, END_SCREEN
 } Stage;
 
-typedef enum {
-  NORMAL, HARD, HARDCORE
-} Mode;
-
 typedef enum {
   T_LTR, T_RTL, T_BTT, T_TTB
 } TransitionType;
 
-typedef struct {
-  Rectangle pos, bullet;
-  int hp, shooting;
-  float next_shoot;
-} Ship;
+typedef enum {
+  TEX_ATLAS, TEX_FONT, TEX_BARRIERS, TEX_COUNT
+} TextureId;
 
-typedef struct {
-  Rectangle pos;
-  int max_hp, hp;
-} Barrier;
+// Mesma ordem do sound_names, que e a ordem em que entram no mixer
+typedef enum {
+  SFX_KEY, SFX_UNDO, SFX_ENTER, SFX_HIT, SFX_NOP, SFX_DEATH,
+  SFX_SHOOT, SFX_SHOOT_2, SFX_SHOOT_3, SFX_SHOOT_4, SFX_E_SHOOT,
+  SFX_DAMAGE, SFX_SHIELD, SFX_BREAK, SFX_COUNT
+} Sfx;
 
 typedef struct {
-  Texture2D player[3], enemy, barrier[4];
-  Sound s_key, s_undo, s_enter, s_hit;
-  Sound s_nop, s_death, s_shoot[4], s_e_shoot;
-  Sound s_damage, s_shield, s_break;
-  Music music;
+  Texture2D atlas, barriers; // barriers = as barreiras lado a lado, cada uma com o dano dela
+  Rectangle player[3], enemy, white; // Regioes dentro do atlas
 } Assets;
 
-typedef struct {
-  Ship player, enemies[12][6];
-  Rectangle borders[4];
-  Barrier barriers[4];
-  char nick[3];
-  Stage stage;
-  Mode mode;
-  float enemy_speed, enemy_bullet_speed;
-  int winner, pts, start_time, timer, level;
-  int enemy_columns, enemy_lines, enemy_shoot_timer;
-} Game;
-
 typedef struct {
   int running;
-  float start, duration;
+  uint64_t start;
+  float duration;
 } Animation;
 
 // ---
 
 void  InitGame();
+void  OpenScores();
+void  ImportLegacyScores(char* path);
 void  ReadRank();
 void  WriteRank();
 void  StageStart();
 void  StageMode();
 void  StageEnd();
 void  StageGame();
+void  EnterRound(Game* game);
 void  DrawEnemies();
 void  DrawPlayer();
 void  DrawHUD();
 void  DrawBullets();
 void  DrawStars();
+void  DrawDebris();
+void  DrawParticles(Particles* p);
+uint32_t PackColor(Color color);
 void  DrawBarriers();
-void  GenerateMap();
-void  PlayerMovement();
-void  EnemiesMovement();
-void  EnemyShoot();
-void  PlayerShoot();
-void  EnemiesBulletCollision();
-void  PlayerBulletCollision();
-void  TakeDamage();
-void  WinGame();
-void  LoseGame();
+void  UpdateBarrierTexture(int i, SpriteMask* pixels);
+void  PushSprite(DrawLayer layer, Rectangle src, Rectangle dst, Color color);
+void  PushQuad(DrawLayer layer, TextureId texture, Rectangle src, Rectangle dst, Color color);
+void  PushRect(DrawLayer layer, Rectangle dst, Color color);
+void  FlushDraws();
+void  DrawStats();
+void  DrawProfiler();
+void  ToggleCapture();
+void  PlayEvents();
+void  InitAudio();
+void  PlaySfx(Sfx sfx, float x);
+Input ReadInput();
 int   StageInEvent();
-void  SetStage(Stage stage);
+void  SetStage(Stage to);
+void  StartSim();
+void  StopSim();
+void* SimWorker(void* arg);
+void  StartPlayback(char* path, int speed);
+void  FinishPlayback(ReplayStep step);
+void  StartNetplay(int port, char* peer, int latency, float loss);
+void  StartAssetDecode();
+void* DecodeWorker(void* arg);
 void  LoadAssets();
+void  LoadAtlas();
+void  LoadMasks();
+void  LoadBarriers();
+void  BuildMask(Image image, int x0, SpriteMask* mask);
+void  LoadTextFont();
 void  UnloadAssets();
 void  StartAnimation(Animation* anim);
 float AnimationKeyFrame(Animation* anim);
 void  StartTransition(Stage to, TransitionType type);
 void  DrawTransition();
 float Shake(float x, float speed, float intensity);
-float TimeSince(float x);
-void  DrawCenteredText(char* str, int size, int x, int y, Color color);
+void  SavePrevious();
+float FormationOffset();
+double TimeSince(uint64_t ns);
+double Seconds();
+void  DrawCenteredText(const char* str, int size, int x, int y, Color color);
+char* ScratchFormat(const char* fmt, ...);
 
 // --- Variáveis Globais
 
-Game g = { .nick = "\0" };
+Game g;
 Assets assets;
-
+SpriteMasks sprite_masks; // Montadas do alfa das imagens, a sim aponta pra elas
+Color barrier_base[SPRITE_SIZE * SPRITE_SIZE]; // Cores da barreira inteira
+SpriteMask barrier_shown[LEN(g.barriers)]; // Pixels que estao na textura agora
+Color barrier_upload[SPRITE_SIZE * SPRITE_SIZE]; // Pedaco que muda, montado aqui pra nao alocar
+
+// Ordem das imagens e a mesma das regioes no LoadAtlas; a barreira fica fora, vira a textura que vai sendo lascada
+char* image_names[] = {
+  "player0.png", "player1.png", "player2.png", "enemy.png", "barrier0.png"
+};
+char* sound_names[] = {
+  "key.wav", "undo.wav", "enter.wav", "hit.wav", "nop.wav", "death.wav",
+  "shoot_1.wav", "shoot_2.wav", "shoot_3.wav", "shoot_4.wav", "shoot.wav",
+  "damage.wav", "shield.wav", "break.wav"
+};
+// Vozes ao mesmo tempo e volume de cada som
+int   sfx_polyphony[] = { 1, 1, 1, 4, 1, 1, 2, 2, 2, 2, 6, 2, 3, 2 };
+float sfx_volume[]    = { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0.2, 1, 1, 1 };
+
+Pack pack;
+Image images[LEN(image_names)];
+Wave waves[LEN(sound_names)];
+pthread_t workers[MAX_LOAD_THREADS];
+int num_workers;
+atomic_int next_job;
+uint64_t asset_timing[4];
+char nick[NAME_SIZE + 1] = "";
+Stage stage;
+char* stage_names[] = { "StageStart", "StageMode", "StageGame", "StageEnd" }; // Nome da zona de cada tela
+
+// Depois do InitGame o historico e da thread de I/O; o menu le a copia do indice, nunca o disco
+ScoreStore scores;
+ScoreIndex score_view;
+Saver saver;
 char saves[5][16] = { 0 };
 char  rank[5][16] = { 0 };
 
+Clock game_clock = { MonotonicNs };
+Stepper stepper;
+uint64_t boot_time;
+// Enquanto sim_active a thread da simulacao e dona do g, do recorder e do playback; o desenho so le o view
+// Quem desliga e ela mesma, quando o round acaba, antes de mandar os eventos do ultimo tick
+Game* view = &g;
+TripleBuffer snapshots;
+EventQueue sim_events;
+Stepper sim_stepper;
+pthread_t sim_thread;
+atomic_int sim_running, sim_active, sim_tick_ns;
+_Atomic Input held, latched; // Teclas lidas no frame, consumidas pela simulacao
+
+// Estado do tick anterior; o desenho fica alpha do caminho entre ele e o atual
+float alpha = 1;
+int target_fps = TICK_RATE;
+float prev_player_x, prev_formation_x;
+
+ReplayRecorder recorder;
+ReplayPlayer playback;
+atomic_int playing; // A simulacao desliga quando o replay acaba no meio do round
+atomic_int playback_cut; // A thread da simulacao parou no meio do round porque a entrada gravada acabou
+int playback_speed;
+
+// Coop pela rede: a sessao e da thread da simulacao; o F1 le os contadores copiados
+NetSession net;
+int netplay;
+atomic_int net_rollbacks, net_stalls, net_resim_ns, net_max_resim_ns;
+
+// Segurar R volta no tempo um tick por tick, F6/F7 salvam e carregam; so fora do coop e do replay
+// O historico e da thread da simulacao, que grava depois de cada tick; quem desenha so pede
+Rewind rewind_buffer;
+atomic_int rewinding, quick_request; // quick_request: 1 salva, 2 carrega
+atomic_int practiced; // A partida veio de um replay, voltou no tempo ou carregou um quick-save: fica fora do historico
+
 Animation a_player_out = { 0, 0, 2 };
 Animation a_player_inn = { 0, 0, 1 };
 Animation transition = { 0, 0, 0.5 };
@@ -132,35 +230,104 @@ Stage transition_to;
 int transitioned = 0;
 
 Color background_color;
-float stars[NUM_STARS][2];
+Particles stars, debris;
 float star_speed;
 
 int stage_in_event;
-int enemy_direction;
-int player_immune;
+
+DrawList draw_list;
+Texture2D textures[TEX_COUNT];
+int draw_batches, draw_vertices, upload_pixels;
+int show_stats;
+
+TextFont font;
+TextCache text_cache;
+Arena scratch; // Zerada no comeco de cada frame
+
+Mixer mixer; // Da thread de audio depois do InitAudio
 
 // ---
 
-int main() {
+// ./prog [--replay FILE [--speed N]] [--vsync | --fps N]
+//        [--host PORT [--mode N] | --join HOST:PORT] [--latency MS] [--loss 0-1]
+// A simulacao roda sempre a TICK_RATE; --fps 0 desenha sem limite
+int main(int argc, char** argv) {
+  char* replay = NULL, * join = NULL;
+  int speed = 1, host = 0, latency = 0, mode = NORMAL;
+  float loss = 0;
+  for (int i = 1; i < argc; i++) {
+    if      (!strcmp(argv[i], "--vsync")) SetConfigFlags(FLAG_VSYNC_HINT), target_fps = 0;
+    else if (i + 1 == argc) break;
+    else if (!strcmp(argv[i], "--replay")) replay     = argv[++i];
+    else if (!strcmp(argv[i], "--speed"))  speed      = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--fps"))    target_fps = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--host"))    host    = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--join"))    join    = argv[++i];
+    else if (!strcmp(argv[i], "--mode"))    mode    = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--latency")) latency = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--loss"))    loss    = atof(argv[++i]);
+  }
+
   SetRandomSeed((long) &g);
   InitGame();
   SetStage(START_SCREEN);
+  // Antes do replay, que traz o modo dele no cabecalho
+  g.mode = MIN(MAX(mode, NORMAL), HARDCORE);
+  if (replay) StartPlayback(replay, speed);
+  if (host || join) StartNetplay(join ? 0 : host, join, latency, loss);
+  StartSim();
 
   while (!WindowShouldClose()) {
-    UpdateMusicStream(assets.music);
+    PROFILE_FRAME_BEGIN();
+    ArenaReset(&scratch);
+    view = &g; // O StageGame troca pelo snapshot mais novo
 
     BeginDrawing();
     ClearBackground(background_color);
+    if (IsKeyPressed(KEY_F1)) show_stats = !show_stats;
+    if (IsKeyPressed(KEY_F4)) ProfileEnable(!profiler.wanted);
+    if (IsKeyPressed(KEY_F5)) ToggleCapture();
+    draw_batches = draw_vertices = upload_pixels = 0;
+    PROFILE_BEGIN("DrawStars");
     DrawStars();
+    PROFILE_END();
     // Onde os estados do jogo são loopados até o usuário sair
-    if      (g.stage == START_SCREEN) StageStart();
-    else if (g.stage == MODE_SCREEN)  StageMode();
-    else if (g.stage == END_SCREEN)   StageEnd();
-    else if (g.stage == GAME_SCREEN)  StageGame();
+    PROFILE_BEGIN(stage_names[stage]);
+    if      (stage == START_SCREEN) StageStart();
+    else if (stage == MODE_SCREEN)  StageMode();
+    else if (stage == END_SCREEN)   StageEnd();
+    else if (stage == GAME_SCREEN)  StageGame();
+    PROFILE_END();
+    PROFILE_BEGIN("DrawDebris");
+    DrawDebris();
+    PROFILE_END();
+    AudioSend(AUDIO_FLUSH, 0, 0); // Sons pedidos fora dos ticks, nos menus
+    PROFILE_BEGIN("FlushDraws");
+    FlushDraws();
+    PROFILE_END();
+    PROFILE_BEGIN("DrawTransition");
     DrawTransition();
+    PROFILE_END();
+    DrawStats();
+    DrawProfiler();
+    // Inclui a espera do vsync
+    PROFILE_BEGIN("EndDrawing");
     EndDrawing();
+    PROFILE_END();
+    PROFILE_FRAME_END();
   }
 
+  if (profiler.capturing) ToggleCapture();
+  StopSim();
+  if (netplay) NetClose(&net);
+
+  SaverStop(&saver);
+  ScoresClose(&scores);
+  ArenaFree(&scratch);
+  ReplayDiscard(&recorder);
+  ReplayUnload(&playback);
+  RewindFree(&rewind_buffer);
+  SimFree(&g);
   UnloadAssets();
   CloseWindow();
   return 0;
@@ -170,73 +337,91 @@ int main() {
 
 // Roda apenas uma vez pra inicializar o jogo
 void InitGame() {
+  boot_time = ClockNow(&game_clock);
+  StepperInit(&stepper, game_clock);
+  StartAssetDecode();
   InitAudioDevice();
   InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Space Invaders");
-  SetTargetFPS(60);
+  SetTargetFPS(target_fps);
   LoadAssets();
-  SetMusicVolume(assets.music, VOLUME * 0.3);
-  SetSoundVolume(assets.s_e_shoot, 0.2);
   SetMasterVolume(VOLUME);
-  PlayMusicStream(assets.music);
-
-  g.borders[0] = (Rectangle) { 0, -30, WINDOW_WIDTH, 30 };           // Up
-  g.borders[1] = (Rectangle) { 0, WINDOW_HEIGHT, WINDOW_WIDTH, 30 }; // Bottom
-  g.borders[2] = (Rectangle) { -30, 0, 30, WINDOW_HEIGHT };          // Left
-  g.borders[3] = (Rectangle) { WINDOW_WIDTH, 0, 30, WINDOW_HEIGHT }; // Right
-
-  for (int i = 0; i < NUM_STARS; i++) {
-    stars[i][0] = GetRandomValue(0, WINDOW_WIDTH);
-    stars[i][1] = GetRandomValue(0, WINDOW_HEIGHT);
+  InitAudio();
+  if (!SimInit(&g, (long) &g) || !ArenaInit(&scratch, SCRATCH_SIZE) || !RewindInit(&rewind_buffer, REWIND_BUDGET)) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  g.masks = &sprite_masks;
+  OpenScores();
+
+  // Camadas de parallax: as do fundo tem mais estrelas, menores, mais lentas e apagadas
+  ParticlesInit(&stars, GetRandomValue(1, 1 << 30));
+  ParticlesInit(&debris, GetRandomValue(1, 1 << 30));
+  for (int i = 0; i < STAR_LAYERS; i++) {
+    int count = NUM_STARS * (STAR_LAYERS - i) / (STAR_LAYERS * (STAR_LAYERS + 1) / 2);
+    unsigned char shade = 255 * (i + 1) / STAR_LAYERS;
+    ParticlesField(&stars, count, WINDOW_WIDTH, WINDOW_HEIGHT, 0.5 + i * 0.65, i + 1, PackColor((Color) { shade, shade, shade, 255 }));
   }
 }
 
-// Le os arquivos de pontuacao
-void ReadRank() {
-  // Cria o arquivo se ele nao existir
-  FILE* f_save = fopen(SAVE_PATH, "a");
-  FILE* f_rank = fopen(RANK_PATH, "a");
-
-  // Le o arquivo
-  f_save = fopen(SAVE_PATH, "r");
-  f_rank = fopen(RANK_PATH, "r");
-
-  int i = 0;
-  while (fgets(saves[i], 32, f_save) && i < 5) i++;
-  i = 0;
-  while (fgets(rank[i], 32, f_rank)  && i < 5) i++;
+// Abre o historico de pontuacoes; na primeira vez importa os arquivos de texto antigos
+// Roda antes do jogo comecar, entao pode ler e escrever direto; depois tudo passa pelo saver
+void OpenScores() {
+  if (!ScoresOpen(&scores, SCORES_LOG, SCORES_IDX))
+    TraceLog(LOG_WARNING, "SCORES: could not open %s, scores will not be saved", SCORES_LOG);
+  if (!scores.index.count) {
+    ImportLegacyScores(RANK_PATH);
+    ImportLegacyScores(SAVE_PATH);
+  }
+  mkdir(REPLAY_DIR, 0755);
 
-  fclose(f_save);
-  fclose(f_rank);
+  score_view = scores.index;
+  if (!SaverStart(&saver, &scores, REPLAY_DIR)) TraceLog(LOG_WARNING, "SCORES: could not start the I/O thread, scores will not be saved");
 }
 
-// Escreve a pontuacao atual nos arquivos
-void WriteRank() {
-  char new_save[32];
-  sprintf(new_save, "%s %d\n", g.nick, g.pts);
+// Os arquivos antigos tem a mais nova em cima, entao entram de baixo pra cima
+void ImportLegacyScores(char* path) {
+  FILE* f = fopen(path, "r");
+  if (!f) return;
 
-  for (int i = 4; i >= 0; i--)
-    strcpy(saves[i], i ? saves[i - 1] : new_save);
+  char lines[5][32], nick[4];
+  int n = 0, pts;
+  while (n < LEN(lines) && fgets(lines[n], sizeof(lines[n]), f)) n++;
+  fclose(f);
 
-  for (int i = 4; i >= 0; i--) {
-    int pts;
-    sscanf(rank[i], "%*s %d", &pts);
-
-    if (!*rank[i] || g.pts > pts) {
-      if (i != 4) strcpy(rank[i + 1], rank[i]);
-      strcpy(rank[i], new_save);
-    }
-  }
+  for (int i = n - 1; i >= 0; i--)
+    if (sscanf(lines[i], "%3s %d", nick, &pts) == 2) ScoresAppend(&scores, nick, pts, NORMAL, 0, 0);
+}
 
-  FILE* f_save = fopen(SAVE_PATH, "w");
-  FILE* f_rank = fopen(RANK_PATH, "w");
+// Monta as linhas do menu a partir do indice em memoria, sem ler arquivo
+void ReadRank() {
+  ScoreRecord top[5], recent[5];
+  int num_top    = ScoresTop(&score_view, 5, top);
+  int num_recent = ScoresRecent(&score_view, 5, recent);
 
   for (int i = 0; i < 5; i++) {
-    if (*saves[i]) fprintf(f_save, "%s", saves[i]);
-    if (*rank[i])  fprintf(f_rank, "%s", rank[i]);
+    *rank[i] = *saves[i] = '\0';
+    if (i < num_top)    snprintf(rank[i],  sizeof(rank[i]),  "%s %d", top[i].nick,    top[i].pts);
+    if (i < num_recent) snprintf(saves[i], sizeof(saves[i]), "%s %d", recent[i].nick, recent[i].pts);
+  }
+}
+
+// Acrescenta a partida atual no historico e salva o replay dela
+// So atualiza a copia em memoria e enfileira; quem escreve (e numera o replay) e a thread de I/O
+void WriteRank() {
+  if (atomic_load(&practiced)) return;
+  PROFILE_BEGIN("WriteRank");
+  uint8_t* data = NULL;
+  size_t size = 0;
+  if (recorder.recording) {
+    ReplayEnd(&recorder, &g);
+    data = ReplayTake(&recorder, &size);
   }
 
-  fclose(f_save);
-  fclose(f_rank);
+  int64_t now = time(NULL);
+  ScoresIndexAdd(&score_view, nick, g.pts, g.mode, g.level, now);
+  SaverRun(&saver, nick, g.pts, g.mode, g.level, now, data, size);
+  ReadRank();
+  PROFILE_END();
 }
 
 // --- Funcoes de cada tela que rodam todo frame
@@ -246,24 +431,21 @@ void StageStart() {
   // "if (StageInEvent())" cria um bloco de código que só executa no primeiro frame do estágio
   if (StageInEvent()) {
     // Inicializa valores toda vez que se entra no menu principal
-    g.player.pos = (Rectangle) { WINDOW_WIDTH / 2.0 - SHIP_WIDTH / 2.0, WINDOW_HEIGHT - SHIP_HEIGHT - 30, SHIP_WIDTH, SHIP_HEIGHT };
     background_color = BACKGROUND_COLOR;
     star_speed = STAR_SPEED;
-    g.winner = 0;
-    g.pts    = 0;
-    g.level  = 0;
+    SimNewRun(&g);
     ReadRank();
   }
 
-  int remaining = NAME_SIZE - strlen(g.nick);
+  int remaining = NAME_SIZE - strlen(nick);
 
   int key = toupper(GetCharPressed());
   if (key >= 65 && key <= 90) {
-    if (!remaining) PlaySound(assets.s_nop);
+    if (!remaining) PlaySfx(SFX_NOP, WINDOW_WIDTH / 2);
     else {
-      g.nick[strlen(g.nick) + 1] = '\0';
-      g.nick[strlen(g.nick)] = key;
-      PlaySound(assets.s_key);
+      nick[strlen(nick) + 1] = '\0';
+      nick[strlen(nick)] = key;
+      PlaySfx(SFX_KEY, WINDOW_WIDTH / 2);
     }
   }
 
@@ -271,42 +453,46 @@ void StageStart() {
   static int rank_toggle = 0;
   if (IsKeyPressed(KEY_TAB) && !transition.running) {
     rank_toggle = !rank_toggle;
-    PlaySound(assets.s_key);
+    PlaySfx(SFX_KEY, WINDOW_WIDTH / 2);
   }
 
   if (IsKeyPressed(KEY_BACKSPACE) && !transition.running) {
-    if (!strlen(g.nick)) PlaySound(assets.s_nop);
+    if (!strlen(nick)) PlaySfx(SFX_NOP, WINDOW_WIDTH / 2);
     else {
-      g.nick[strlen(g.nick) - 1] = '\0';
-      PlaySound(assets.s_undo);
+      nick[strlen(nick) - 1] = '\0';
+      PlaySfx(SFX_UNDO, WINDOW_WIDTH / 2);
     }
   }
 
   if ((IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_ENTER)) && !transition.running) {
-    if (remaining) PlaySound(assets.s_nop);
+    if (remaining) PlaySfx(SFX_NOP, WINDOW_WIDTH / 2);
     else {
       StartTransition(MODE_SCREEN, T_LTR);
-      PlaySound(assets.s_enter);
+      PlaySfx(SFX_ENTER, WINDOW_WIDTH / 2);
     }
   }
 
-  // Label Buffer
-  char label_buf[64];
-  char empty[remaining + 1];
-  memset(empty, ' ', remaining);
-  empty[remaining] = '\0';
-  sprintf(label_buf, ">%sNICKNAME%s<", empty, empty);
-
-  // Nickname Buffer
-  char nick_buf[64];
-  strcpy(nick_buf, g.nick);
-  if (strlen(g.nick) < NAME_SIZE) strcat(nick_buf, "_");
+  // Os textos so sao remontados quando o nick ou o historico mudam
+  static char label_buf[32], nick_buf[NAME_SIZE + 2], best_buf[32], shown[NAME_SIZE + 2] = "\1";
+  static uint64_t shown_count;
+  if (strcmp(shown, nick) || shown_count != score_view.count) {
+    shown_count = score_view.count;
+    int pts;
+    uint32_t rec;
+    strcpy(shown, nick);
+    remaining = NAME_SIZE - strlen(nick);
+    snprintf(label_buf, sizeof(label_buf), ">%*sNICKNAME%*s<", remaining, "", remaining, "");
+    snprintf(nick_buf, sizeof(nick_buf), "%s%s", nick, remaining ? "_" : "");
+    *best_buf = '\0';
+    if (!remaining && ScoresBest(&score_view, nick, &pts, &rec)) snprintf(best_buf, sizeof(best_buf), "BEST %d", pts);
+  }
 
   DrawCenteredText(SPICY_MODE ? "SPICY INVADERS" : "SPACE INVADERS", 69, 0, 40, DARKBROWN);
   DrawCenteredText(SPICY_MODE ? "SPICY INVADERS" : "SPACE INVADERS", 70, 0, 30, YELLOW);
   DrawCenteredText(label_buf, 40, 0, 170, remaining ? WHITE : PURPLE);
   if (!remaining) DrawCenteredText(nick_buf,  40, Shake(-0.2, 13, 3), 220 + Shake(-0.2, 5, 4), DARKPURPLE);
   DrawCenteredText(nick_buf,  40, Shake(0, 13, 3), 220 + Shake(0, 5, 4), remaining ? WHITE : PURPLE);
+  if (*best_buf) DrawCenteredText(best_buf, 20, 0, 265, GRAY);
   for (int i = 0; i < 5; i++) DrawCenteredText(rank_toggle ? rank[i] : saves[i], 50, 0, 300 + 55 * i, PURPLE);
 }
 
@@ -315,53 +501,76 @@ void StageMode() {
   static Mode selected = NORMAL;
 
   if ((IsKeyPressed(KEY_S) || IsKeyPressed(KEY_DOWN)) && !transition.running) {
-    if (selected == HARDCORE) PlaySound(assets.s_nop);
+    if (selected == HARDCORE) PlaySfx(SFX_NOP, WINDOW_WIDTH / 2);
     else {
       selected++;
-      PlaySound(assets.s_key);
+      PlaySfx(SFX_KEY, WINDOW_WIDTH / 2);
     }
   }
 
   if ((IsKeyPressed(KEY_W) || IsKeyPressed(KEY_UP)) && !transition.running) {
-    if (!selected) PlaySound(assets.s_nop);
+    if (!selected) PlaySfx(SFX_NOP, WINDOW_WIDTH / 2);
     else {
       selected--;
-      PlaySound(assets.s_key);
+      PlaySfx(SFX_KEY, WINDOW_WIDTH / 2);
     }
   }
 
   if ((IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_ENTER)) && !transition.running) {
     StartTransition(GAME_SCREEN, T_BTT);
     g.mode = selected;
-    PlaySound(assets.s_enter);
+    PlaySfx(SFX_ENTER, WINDOW_WIDTH / 2);
   }
 
   DrawCenteredText(SPICY_MODE ? "SPICY INVADERS" : "SPACE INVADERS", 69, 0, 40, DARKBROWN);
   DrawCenteredText(SPICY_MODE ? "SPICY INVADERS" : "SPACE INVADERS", 70, 0, 30, YELLOW);
 
-  char buffer[32];
-  for (int i = 0; i <= HARDCORE; i++) {
-    Color color[]   = { WHITE,    PURPLE,     RED       };
-    Color color_d[] = { GRAY,     DARKPURPLE, DARKBROWN };
-    char mode[][32] = { "NORMAL", "HARD",     "HARDCORE"};
+  Color color[]   = { WHITE,    PURPLE,     RED        };
+  Color color_d[] = { GRAY,     DARKPURPLE, DARKBROWN  };
+  char* mode[]    = { "NORMAL", "HARD",     "HARDCORE" };
+  char* marked[]  = { "> NORMAL <", "> HARD <", "> HARDCORE <" };
 
-    sprintf(buffer, selected == i ? "> %s <" : "%s", mode[i]);
+  for (int i = 0; i <= HARDCORE; i++) {
     if (selected == i) {
-      DrawCenteredText(buffer, 55, Shake(-0.2, 9 * (i + 1), 4), 250 + 100 * i + Shake(-0.2, 5 * (i + 1), 3), color_d[i]);
-      DrawCenteredText(buffer, 55, Shake(0,    9 * (i + 1), 4), 250 + 100 * i + Shake(0,    5 * (i + 1), 3), color[i]);
+      DrawCenteredText(marked[i], 55, Shake(-0.2, 9 * (i + 1), 4), 250 + 100 * i + Shake(-0.2, 5 * (i + 1), 3), color_d[i]);
+      DrawCenteredText(marked[i], 55, Shake(0,    9 * (i + 1), 4), 250 + 100 * i + Shake(0,    5 * (i + 1), 3), color[i]);
     }
-    else DrawCenteredText(buffer, 50, 0, 250 + 100 * i, color[i]);
+    else DrawCenteredText(mode[i], 50, 0, 250 + 100 * i, color[i]);
   }
 }
 
+// Fundo, estrelas e entrada do jogador de um round novo
+void EnterRound(Game* game) {
+  a_player_out.running = 0;
+  StartAnimation(&a_player_inn);
+
+  background_color = BACKGROUND_COLOR;
+  background_color.r += game->mode * DAMAGE_REDNESS;
+  star_speed = STAR_SPEED + (MIN(game->level - 0, 10) / 4.0) * (game->mode + 1) * 0.5;
+  ParticlesClear(&debris);
+}
+
 // Tela Final
 void StageEnd() {
+  if (StageInEvent()) {
+    StepperReset(&stepper);
+    SavePrevious();
+  }
+
+  // No replay o proximo round comeca sozinho depois da animacao
+  if (playing && g.winner && !a_player_out.running && !transition.running) StartTransition(GAME_SCREEN, T_BTT);
+
   if ((IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_ENTER)) && !transition.running) {
     StartTransition(g.winner ? GAME_SCREEN : START_SCREEN, g.winner ? T_BTT : T_RTL);
-    PlaySound(assets.s_enter);
+    PlaySfx(SFX_ENTER, WINDOW_WIDTH / 2);
   }
 
-  if (!g.winner) EnemiesMovement();
+  // Os inimigos continuam andando no ritmo da simulacao
+  for (int n = StepperAdvance(&stepper); n > 0; n--) {
+    SavePrevious();
+    if (!g.winner) EnemiesMovement(&g);
+  }
+  alpha = StepperAlpha(&stepper);
 
   if (a_player_out.running) {
     float x = AnimationKeyFrame(&a_player_out);
@@ -383,69 +592,96 @@ void StageEnd() {
 void StageGame() {
   // Bloco que roda no inicio de cada round
   if (StageInEvent()) {
-    g.level++;
-    g.player.pos.y  = WINDOW_HEIGHT - SHIP_HEIGHT - 30;
-    g.player.bullet = (Rectangle) { 0, 0, BULLET_WIDTH, BULLET_HEIGHT };
-    g.player.shooting = 0;
-    player_immune = 0;
-    enemy_direction = 1;
-    a_player_out.running = 0;
-    StartAnimation(&a_player_inn);
-    g.player.hp = 3 - g.mode;
-
-    GenerateMap();
-  }
-  if (TimeSince(g.start_time) > g.timer) LoseGame();           // Faz o player perder o jogo caso alcance o tempo limite
-  if (IsKeyPressed(KEY_F2) && !transition.running) WinGame();  // Atalho pro jogador ganhar caso aperte F2
-  if (IsKeyPressed(KEY_F3) && !transition.running) LoseGame(); // Atalho pro jogador perder caso aperte F3
-
-  // Decrementa os frames de imunidade se o player estiver imune
-  if (player_immune) player_immune--;
-
-  EnemiesMovement();
-  PlayerMovement();
-  EnemyShoot();
-  PlayerShoot();
+    Input unused;
+    ReplayStep step;
+    // Replay que acaba entre dois rounds volta pro menu em vez de passar o round pro teclado
+    if (playing && (step = ReplayNext(&playback, &unused)) != REPLAY_ROUND) {
+      FinishPlayback(step);
+      SetStage(START_SCREEN);
+      return;
+    }
+    // A gravacao comeca antes do primeiro round da partida; no coop o NetStart ja montou o round e nao tem replay
+    if (!playing && !netplay && !g.level) ReplayBegin(&recorder, &g, nick);
+    // Partida nova: o quick-save de uma partida (ou modo) anterior nao vale nela
+    if (!g.level) {
+      RewindQuickDrop(&rewind_buffer);
+      atomic_store(&practiced, playing);
+    }
+    ReplayRound(&recorder);
+    if (!netplay) SimStartRound(&g);
+    RewindClear(&rewind_buffer);
+    RewindPush(&rewind_buffer, &g);
+    EnterRound(&g);
+
+    // Ainda sem a simulacao rodando, entao esta thread pode publicar o primeiro snapshot
+    SnapshotTake(TripleBack(&snapshots), &g, g.player.pos.x, g.enemies.x[0], ClockNow(&game_clock));
+    TriplePublish(&snapshots);
+    StepperReset(&sim_stepper);
+    atomic_store_explicit(&sim_active, 1, memory_order_release);
+  }
+
+  if (atomic_exchange(&playback_cut, 0)) SetStage(END_SCREEN);
+  atomic_store(&held, ReadInput());
+  int practice = !netplay && !playing;
+  atomic_store(&rewinding, practice && IsKeyDown(KEY_R));
+  if (practice && IsKeyPressed(KEY_F6)) atomic_store(&quick_request, 1);
+  if (practice && IsKeyPressed(KEY_F7)) atomic_store(&quick_request, 2);
+  Snapshot* s = TripleLatest(&snapshots);
+  view = &s->game;
+  // O coop troca de round dentro da simulacao; o fim da pausa e o round novo
+  static int was_over;
+  if (netplay && was_over && !view->over) EnterRound(view);
+  was_over = view->over;
+  prev_player_x = s->prev_player_x;
+  prev_formation_x = s->prev_formation_x;
+  alpha = MIN(1, TimeSince(s->time) * TICK_RATE);
+
+  PROFILE_BEGIN("PlayEvents");
+  PlayEvents();
+  AudioSend(AUDIO_FLUSH, 0, 0); // Sons iguais do mesmo lote de ticks viram uma voz so
+  PROFILE_END();
+
   DrawBullets();
   DrawEnemies();
   DrawPlayer();
   DrawBarriers();
   DrawHUD();
+
+  // No coop nao tem tela final, o proximo round comeca sozinho depois do NET_ROUND_DELAY
+  if (netplay && view->over) {
+    DrawCenteredText(view->winner ? "YOU WON" : "YOU DIED", 80, 0, 250, view->winner ? GREEN : RED);
+    DrawCenteredText(view->winner ? "- Next level -" : "- Starting over -", 38, 0, WINDOW_HEIGHT - 50, GRAY);
+  }
 }
 
 // --- Funcoes responsaveis por desenhar o jogo
 
 void DrawHUD() {
-  DrawRectangle(0, WINDOW_HEIGHT - 3, WINDOW_WIDTH * (g.timer - TimeSince(g.start_time)) / g.timer, 3, WHITE);
+  PushRect(LAYER_HUD, (Rectangle) { 0, WINDOW_HEIGHT - 3, WINDOW_WIDTH * SimTimeLeft(view) / (view->timer * TICK_RATE), 3 }, WHITE);
+  if (playing) DrawCenteredText(ScratchFormat("REPLAY %dx", playback_speed), 20, 0, WINDOW_HEIGHT - 30, GRAY);
+  if (atomic_load(&rewinding)) DrawCenteredText("<< REWIND", 20, 0, WINDOW_HEIGHT - 30, GRAY);
 }
 
 void DrawEnemies() {
-  Vector2 frame_size = { 32, 32 };
-
-  static int frame = 0;
-  static int last_swap = 0;
-
-  if (TimeSince(last_swap) > 1) {
-    frame = !frame;
-    last_swap = GetTime();
-  }
-
-  Rectangle frame_rec = { frame * frame_size.x, 0, frame_size.x, frame_size.y };
-
-  for (int i = 0; i < g.enemy_columns; i++) {
-    for (int j = 0; j < g.enemy_lines; j++) {
-      // So desenha se o inimigo estiver vivo
-      if(g.enemies[i][j].hp) {
-        Rectangle pos_rec   = { g.enemies[i][j].pos.x, g.enemies[i][j].pos.y, 32, 32 };
-        DrawTexturePro(assets.enemy, frame_rec, pos_rec, (Vector2) { 0, 0 }, 0, WHITE);
-      }
+  // Troca o frame a cada segundo de jogo, junto com a mascara que a sim usa
+  int frame = EnemyFrame(view);
+
+  Rectangle frame_rec = { assets.enemy.x + frame * 32, assets.enemy.y, 32, 32 };
+  float offset = FormationOffset();
+
+  for (int k = 0; k < view->enemies.count; k++) {
+    // So desenha se o inimigo estiver vivo
+    if (view->enemies.alive[k]) {
+      Rectangle pos_rec = EnemyRec(&view->enemies, k);
+      pos_rec.x += offset;
+      PushSprite(LAYER_SPRITES, frame_rec, pos_rec, WHITE);
     }
   }
 }
 
 void DrawPlayer() {
-  Rectangle frame_rec = { 0, 0, 32, 32 };
-  Rectangle pos_rec   = { g.player.pos.x, g.player.pos.y, 32, 32 };
+  float x = prev_player_x + (view->player.pos.x - prev_player_x) * alpha;
+  Rectangle pos_rec = { x, view->player.pos.y, 32, 32 };
 
   // Animacao do player entrar na tela
   if (a_player_inn.running) {
@@ -453,283 +689,585 @@ void DrawPlayer() {
     pos_rec.y += pow(x - 1, 2) * 50;
   }
 
-  Color color = { 255, 255, 255, player_immune ? 127 : 255 };
-  int spr_i = 3 - (float) g.player.hp;
-  DrawTexturePro(assets.player[spr_i], frame_rec, pos_rec, (Vector2) { 0, 0 }, 0, color);
+  Color color = { 255, 255, 255, view->player_immune ? 127 : 255 };
+  int spr_i = 3 - (float) view->player.hp;
+  if (view->player.hp) PushSprite(LAYER_SPRITES, assets.player[spr_i], pos_rec, color);
+
+  // O parceiro vem sem interpolar, no rollback a posicao dele pode pular de qualquer jeito
+  if (!view->coop || !view->partner.hp) return;
+  pos_rec.x = view->partner.pos.x;
+  color = (Color) { 130, 200, 255, view->partner_immune ? 127 : 255 };
+  PushSprite(LAYER_SPRITES, assets.player[MAX(0, 3 - view->partner.hp)], pos_rec, color);
 }
 
 void DrawBullets() {
-  if (g.player.shooting) DrawRectangleRec(g.player.bullet, PURPLE);
-
-  for (int i = 0; i < g.enemy_columns; i++)
-    for (int j = 0; j < g.enemy_lines; j++)
-      if (g.enemies[i][j].shooting)
-        DrawRectangleRec(g.enemies[i][j].bullet, GREEN);
+  // Os tiros so andam em y, vy por tick; o anterior e um passo atras
+  for (int n = 0; n < view->bullets.count; n++) {
+    Rectangle rec = BulletRec(&view->bullets, n);
+    rec.y += view->bullets.vy[n] * (alpha - 1);
+    PushRect(LAYER_BULLETS, rec, view->bullets.owner[n] == OWNER_PLAYER ? PURPLE : GREEN);
+  }
 }
 
 void DrawStars() {
-  // Desenha e move as estrelas
-  for (int i = 0; i < NUM_STARS; i++) {
-    stars[i][1] = CIRCULAR_CLAMP(-2, stars[i][1] + star_speed, WINDOW_HEIGHT);
-    DrawRectangle(stars[i][0], stars[i][1], 2, 2, WHITE);
+  // Desenha e move as estrelas, cada camada na velocidade dela
+  ParticlesUpdate(&stars, star_speed * GetFrameTime() * TICK_RATE, 0);
+  ParticlesWrap(&stars, -2, WINDOW_HEIGHT);
+  DrawParticles(&stars);
+}
+
+// Estilhacos de inimigos, barreiras e do player
+void DrawDebris() {
+  float dt = GetFrameTime() * TICK_RATE;
+  ParticlesUpdate(&debris, dt, DEBRIS_GRAVITY);
+  ParticlesReap(&debris);
+  DrawParticles(&debris);
+}
+
+// Um quad por particula direto no rlgl, tudo com a textura do atlas num lote so
+void DrawParticles(Particles* p) {
+  if (!p->count) return;
+  FlushDraws();
+
+  Rectangle w = assets.white;
+  float u = (w.x + w.width / 2) / assets.atlas.width, v = (w.y + w.height / 2) / assets.atlas.height;
+
+  rlSetTexture(assets.atlas.id);
+  rlBegin(RL_QUADS);
+  for (int i = 0; i < p->count; i++) {
+    uint32_t c = p->color[i];
+    float alpha = p->fade[i] ? MIN(1, p->life[i] * p->fade[i] * 2) : 1;
+    float x = p->x[i], y = p->y[i], s = p->size[i];
+    rlColor4ub(c, c >> 8, c >> 16, (c >> 24) * alpha);
+    rlTexCoord2f(u, v);
+    rlVertex2f(x, y);
+    rlVertex2f(x, y + s);
+    rlVertex2f(x + s, y + s);
+    rlVertex2f(x + s, y);
   }
+  rlEnd();
+  rlSetTexture(0);
+
+  draw_batches  += 1;
+  draw_vertices += p->count * 4;
 }
 
 void DrawBarriers() {
-  Rectangle frame_rec = { 0, 0, 32, 32 };
-  for (int i = 0; i < LEN(g.barriers); i++) {
-    if (!g.barriers[i].hp) continue;
-    Rectangle pos_rec = { g.barriers[i].pos.x, g.barriers[i].pos.y, 32, 32 };
-    int spr_i = 4 - (float) g.barriers[i].hp / g.barriers[i].max_hp * 4;
-    DrawTexturePro(assets.barrier[spr_i], frame_rec, pos_rec, (Vector2) { 0, 0 }, 0, WHITE);
+  for (int i = 0; i < LEN(view->barriers); i++) {
+    Barrier* barrier = &view->barriers[i];
+    UpdateBarrierTexture(i, &barrier->pixels);
+    if (!barrier->hp) continue;
+    Rectangle src = { i * SPRITE_SIZE, 0, SPRITE_SIZE, SPRITE_SIZE };
+    PushQuad(LAYER_SPRITES, TEX_BARRIERS, src, barrier->pos, WHITE);
   }
 }
 
-// --- Funcoes do jogo
+// Sobe so o retangulo das linhas e colunas que mudaram desde o que esta na textura
+// Varios tiros no mesmo frame viram um upload so; voltar no tempo ou um round novo devolvem os pixels do mesmo jeito
+void UpdateBarrierTexture(int i, SpriteMask* pixels) {
+  int r0 = SPRITE_SIZE, r1 = -1;
+  uint32_t columns = 0;
+  for (int r = 0; r < SPRITE_SIZE; r++) {
+    uint32_t changed = pixels->rows[r] ^ barrier_shown[i].rows[r];
+    if (!changed) continue;
+    r0 = MIN(r0, r);
+    r1 = r;
+    columns |= changed;
+  }
+  if (!columns) return;
+
+  int c0 = __builtin_ctz(columns), c1 = SPRITE_SIZE - 1 - __builtin_clz(columns);
+  int w = c1 - c0 + 1, h = r1 - r0 + 1;
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++)
+      barrier_upload[y * w + x] = pixels->rows[r0 + y] >> (c0 + x) & 1 ? barrier_base[(r0 + y) * SPRITE_SIZE + c0 + x] : BLANK;
+  UpdateTextureRec(assets.barriers, (Rectangle) { i * SPRITE_SIZE + c0, r0, w, h }, barrier_upload);
+  barrier_shown[i] = *pixels;
+  upload_pixels += w * h;
+}
 
-void GenerateMap() {
-  background_color = BACKGROUND_COLOR;
-  background_color.r += g.mode * DAMAGE_REDNESS;
-  star_speed = STAR_SPEED + (MIN(g.level - 0, 10) / 4.0) * (g.mode + 1) * 0.5;
-
-  g.enemy_columns = MIN(7 + ((g.level - 1) / 2), LEN(g.enemies));
-  g.enemy_lines = MIN(4 + (g.level < 5 ? 0 : ((g.level - 6) / 2)), LEN(g.enemies[0]));
-  g.timer = MAX(80, 100 - (g.level * 5));
-  g.start_time = GetTime();
-
-  // Inicializa a matriz dos inimigos
-  for (int i = 0; i < LEN(g.enemies); i++) {
-    for (int j = 0; j < LEN(g.enemies[0]); j++) {
-      g.enemies[i][j].hp = i < g.enemy_columns && j < g.enemy_lines;
-      g.enemies[i][j].shooting = 0;
-      g.enemies[i][j].next_shoot = GetTime() + GetRandomValue(1, 5);
-      g.enemies[i][j].pos = (Rectangle) { i * 60, 15 + j * 60, SHIP_WIDTH, SHIP_HEIGHT };
-      g.enemies[i][j].bullet = (Rectangle) { 0, 0, BULLET_WIDTH, BULLET_HEIGHT };
-      g.enemy_bullet_speed = g.mode == NORMAL ? 5 : g.mode == HARD ? 6 : 7;
-      g.enemy_bullet_speed *= 1 + MIN(0.2, g.level / 10.0);
-      g.enemy_shoot_timer  = g.mode == NORMAL ? 4 : g.mode == HARD ? 3 : 2;
-      g.enemy_shoot_timer  *= 1 - MIN(0.2, g.level / 10.0);
-      g.enemy_speed        = g.mode == NORMAL ? 3 : g.mode == HARD ? 4.5 : 6;
-      g.enemy_speed        *= 1 + MIN(0.2, g.level / 10.0);
-    }
+// Sprite com origem no atlas, vai pra lista e so e desenhado no FlushDraws
+void PushSprite(DrawLayer layer, Rectangle src, Rectangle dst, Color color) {
+  PushQuad(layer, TEX_ATLAS, src, dst, color);
+}
+
+void PushQuad(DrawLayer layer, TextureId texture, Rectangle src, Rectangle dst, Color color) {
+  uint32_t tint = PackColor(color);
+  if (!DrawListPush(&draw_list, layer, texture, src, dst, tint)) {
+    FlushDraws();
+    DrawListPush(&draw_list, layer, texture, src, dst, tint);
   }
+}
 
-  // Inicializa as barreiras
-  for (int i = 0; i < LEN(g.barriers); i++) {
-    g.barriers[i].max_hp = g.mode == NORMAL ? 5 : g.mode == HARD ? 8 : 10;
-    g.barriers[i].hp = g.barriers[i].max_hp;
-    g.barriers[i].pos = (Rectangle) { (i + 1) * ((float) WINDOW_WIDTH / ((int)LEN(g.barriers) + 1)), 400, SHIP_WIDTH, SHIP_HEIGHT };
+// Retangulo liso usando o pixel branco do atlas, pra nao quebrar o lote
+void PushRect(DrawLayer layer, Rectangle dst, Color color) {
+  PushSprite(layer, assets.white, dst, color);
+}
+
+// Ordena por camada e textura e envia tudo que foi empilhado ate agora
+void FlushDraws() {
+  if (!draw_list.count) return;
+  DrawCmd* cmds = DrawListSort(&draw_list);
+  for (int n = 0; n < draw_list.count; n++) {
+    Color tint = { cmds[n].tint, cmds[n].tint >> 8, cmds[n].tint >> 16, cmds[n].tint >> 24 };
+    DrawTexturePro(textures[cmds[n].texture], cmds[n].src, cmds[n].dst, (Vector2) { 0, 0 }, 0, tint);
   }
+  draw_batches  += draw_list.batches;
+  draw_vertices += draw_list.vertices;
+  DrawListClear(&draw_list);
 }
 
-void PlayerMovement() {
-  if ((IsKeyDown(KEY_D) || IsKeyDown(KEY_RIGHT)) && !CheckCollisionRecs(g.player.pos, g.borders[3])) g.player.pos.x += 5;
-  if ((IsKeyDown(KEY_A) || IsKeyDown(KEY_LEFT))  && !CheckCollisionRecs(g.player.pos, g.borders[2])) g.player.pos.x -= 5;
+uint32_t PackColor(Color color) {
+  return color.r | color.g << 8 | color.b << 16 | (uint32_t) color.a << 24;
 }
 
-void EnemiesMovement() {
-  for (int i = 0; i < g.enemy_columns; i++) {
-    for (int j = 0; j < g.enemy_lines; j++) {
-      if      (CheckCollisionRecs(g.enemies[i][j].pos, g.borders[2])) enemy_direction =  1;
-      else if (CheckCollisionRecs(g.enemies[i][j].pos, g.borders[3])) enemy_direction = -1;
-    }
+// Contadores de lotes e vertices do frame, liga e desliga no F1
+void DrawStats() {
+  if (!show_stats) return;
+  AudioStats* a = &audio.stats;
+  DrawText(TextFormat("%d fps  %d batches  %d vertices  %d particles  %d voices  %d px uploaded  sim %.1f us/tick", GetFPS(), draw_batches,
+                      draw_vertices, stars.count + debris.count, atomic_load(&a->voices), upload_pixels, atomic_load(&sim_tick_ns) / 1e3), 5, 5, 10, GREEN);
+  DrawText(TextFormat("audio: music %d frames %d underruns  sfx %d frames %d underruns  %d dropped",
+                      atomic_load(&a->music_frames), atomic_load(&a->music_underruns), atomic_load(&a->sfx_frames),
+                      atomic_load(&a->sfx_underruns), atomic_load(&a->dropped)), 5, 17, 10, GREEN);
+  DrawText(TextFormat("io: %d failed  %d dropped", atomic_load(&saver.failed), atomic_load(&saver.dropped)), 5, 29, 10, GREEN);
+  if (netplay)
+    DrawText(TextFormat("net: %d rollbacks  resim %.1f us/frame (max %.1f us)  %d stalls", atomic_load(&net_rollbacks),
+                        atomic_load(&net_resim_ns) / 1e3, atomic_load(&net_max_resim_ns) / 1e3, atomic_load(&net_stalls)), 5, 41, 10, GREEN);
+}
+
+// Grafico do tempo de frame, histograma e zonas do ultimo frame, liga e desliga no F4
+void DrawProfiler() {
+  if (profiler.capturing) DrawText("REC", WINDOW_WIDTH - 25, 5, 10, RED);
+  if (!profiler.wanted) return;
+
+  int x = WINDOW_WIDTH - PROFILE_HISTORY - 10, y = 20, h = 60;
+
+  // Do frame mais antigo pro mais novo; a altura toda sao dois frames de 60 fps
+  DrawRectangle(x, y, PROFILE_HISTORY, h, Fade(BLACK, 0.6));
+  for (int i = 0; i < PROFILE_HISTORY; i++) {
+    float ms = profiler.history[(profiler.history_pos + i) % PROFILE_HISTORY];
+    int bar = MIN(h, ms * h / 33.3);
+    DrawRectangle(x + i, y + h - bar, 1, bar, ms > 17 ? RED : GREEN);
+  }
+  DrawLine(x, y + h / 2, x + PROFILE_HISTORY, y + h / 2, GRAY);
+
+  // Histograma de 1 ms por balde desde que o jogo abriu
+  y += h + 5;
+  int peak = 1, w = PROFILE_HISTORY / PROFILE_BUCKETS;
+  for (int i = 0; i < PROFILE_BUCKETS; i++) peak = MAX(peak, profiler.histogram[i]);
+  DrawRectangle(x, y, PROFILE_HISTORY, h, Fade(BLACK, 0.6));
+  for (int i = 0; i < PROFILE_BUCKETS; i++) {
+    int bar = profiler.histogram[i] * h / peak;
+    DrawRectangle(x + i * w, y + h - bar, w - 1, bar, i >= 17 ? RED : SKYBLUE);
   }
 
-  for (int i = 0; i < g.enemy_columns; i++)
-    for (int j = 0; j < g.enemy_lines; j++)
-      g.enemies[i][j].pos.x += g.enemy_speed * enemy_direction;
+  // Zonas do ultimo frame, indentadas pela profundidade
+  y += h + 5;
+  for (int i = 0; i < profiler.num_last && y + 11 * i < WINDOW_HEIGHT - 10; i++) {
+    ProfileZone* z = &profiler.last[i];
+    DrawText(TextFormat("%*s%s %.3f ms", z->depth * 2, "", z->name, (z->end - z->start) / 1e6), x, y + 11 * i, 10, WHITE);
+  }
 }
 
-void EnemyShoot() {
-  for (int i = 0; i < g.enemy_columns; i++) {
-    for (int j = 0; j < g.enemy_lines; j++) {
-      if (g.enemies[i][j].shooting) {
-        EnemiesBulletCollision();
-        g.enemies[i][j].bullet.y += g.enemy_bullet_speed;
-        continue;
-      }
+// Comeca ou termina a gravacao do trace no F5
+void ToggleCapture() {
+  if (!profiler.capturing) {
+    if (!ProfileCaptureStart()) TraceLog(LOG_WARNING, "PROFILER: could not start capture");
+    return;
+  }
+  int count = ProfileCaptureStop(TRACE_FILE);
+  TraceLog(LOG_INFO, "PROFILER: %d zones written to %s", count, TRACE_FILE);
+}
 
-      // Atira se o inimigo estiver vivo e no tempo
-      if (TimeSince(g.enemies[i][j].next_shoot) < 0 || !g.enemies[i][j].hp || (g.enemies[i][j+1].hp && j+1 < LEN(g.enemies[0]))) continue;
-      g.enemies[i][j].bullet.x = g.enemies[i][j].pos.x + g.enemies[i][j].pos.width  / 2;
-      g.enemies[i][j].bullet.y = g.enemies[i][j].pos.y + g.enemies[i][j].pos.height / 2;
-      g.enemies[i][j].shooting = 1;
-      g.enemies[i][j].next_shoot = GetTime() + g.enemy_shoot_timer;
-      PlaySound(assets.s_e_shoot);
+// --- Ponte entre a simulacao e a apresentacao
+
+// Le o teclado e monta a entrada do tick
+Input ReadInput() {
+  Input input = 0;
+  if (IsKeyDown(KEY_D) || IsKeyDown(KEY_RIGHT)) input |= IN_RIGHT;
+  if (IsKeyDown(KEY_A) || IsKeyDown(KEY_LEFT))  input |= IN_LEFT;
+  if (IsKeyDown(KEY_SPACE)) input |= IN_SHOOT;
+  // Teclas de um frame so ficam guardadas ate algum tick consumir
+  if (IsKeyPressed(KEY_F2) && !transition.running) latched |= IN_WIN;  // Atalho pro jogador ganhar caso aperte F2
+  if (IsKeyPressed(KEY_F3) && !transition.running) latched |= IN_LOSE; // Atalho pro jogador perder caso aperte F3
+  return input;
+}
+
+// Toca os sons e troca de estagio conforme os eventos que a simulacao mandou desde o ultimo frame
+// Os de fim de round chegam depois dela devolver o g, entao daqui pra baixo ele pode ser usado
+void PlayEvents() {
+  Event event, * e = &event;
+  while (EventQueuePop(&sim_events, e)) {
+    switch (e->type) {
+      case EV_PLAYER_SHOOT:  PlaySfx(SFX_SHOOT + GetRandomValue(0, 3), e->x); break;
+      case EV_ENEMY_SHOOT:   PlaySfx(SFX_E_SHOOT, e->x); break;
+      case EV_ENEMY_KILLED:
+        PlaySfx(SFX_HIT, e->x + view->enemies.size / 2);
+        // Inimigos menores do enxame soltam menos estilhacos
+        ParticlesBurst(&debris, MAX(6, 40 * view->enemies.size / SHIP_WIDTH), e->x + view->enemies.size / 2, e->y + view->enemies.size / 2, 4, 45, 3, PackColor(GREEN));
+        break;
+      case EV_BARRIER_HIT:
+        PlaySfx(SFX_SHIELD, e->x);
+        ParticlesBurst(&debris, 8, e->x + BULLET_WIDTH / 2, e->y + BULLET_HEIGHT, 2, 25, 2, PackColor(PURPLE));
+        break;
+      case EV_BARRIER_BREAK:
+        PlaySfx(SFX_BREAK, e->x);
+        ParticlesBurst(&debris, 120, e->x + BULLET_WIDTH / 2, e->y + BULLET_HEIGHT, 5, 60, 3, PackColor(PURPLE));
+        break;
+      case EV_PLAYER_DAMAGE:
+        PlaySfx(SFX_DAMAGE, e->x + SHIP_WIDTH / 2);
+        ParticlesBurst(&debris, 30, e->x + SHIP_WIDTH / 2, e->y + SHIP_HEIGHT / 2, 3, 35, 2, PackColor(RED));
+        background_color.r += DAMAGE_REDNESS;
+        if (e->arg) PlaySfx(SFX_HIT, e->x + SHIP_WIDTH / 2);
+        break;
+      case EV_WIN:
+        if (netplay) {
+          PlaySfx(SFX_HIT, view->player.pos.x + SHIP_WIDTH / 2);
+          break;
+        }
+        StartAnimation(&a_player_out);
+        SetStage(END_SCREEN);
+        PlaySfx(SFX_HIT, g.player.pos.x + SHIP_WIDTH / 2);
+        break;
+      case EV_LOSE:
+        if (netplay) {
+          PlaySfx(SFX_DEATH, view->player.pos.x + SHIP_WIDTH / 2);
+          break;
+        }
+        SetStage(END_SCREEN);
+        PlaySfx(SFX_DEATH, g.player.pos.x + SHIP_WIDTH / 2);
+        if (playing) FinishPlayback(ReplayNext(&playback, &(Input) { 0 }));
+        else WriteRank();
+        break;
     }
   }
 }
 
-void PlayerShoot() {
-  if (g.player.shooting) {
-    PlayerBulletCollision();
-    g.player.bullet.y -= 15;
-    return;
+// --- Efeitos sonoros
+
+// Entrega os sons ao mixer e sobe a thread de audio; dai em diante so conversa com ela pela fila
+// A musica e lida em streaming direto do mapeamento, que fica aberto ate o UnloadAssets
+void InitAudio() {
+  MixerInit(&mixer, WINDOW_WIDTH);
+  for (int i = 0; i < LEN(sound_names); i++)
+    MixerAddSound(&mixer, waves[i].data, waves[i].frameCount, sfx_polyphony[i], sfx_volume[i]);
+
+  int size;
+  const unsigned char* music = PackFind(&pack, "soundtrack.mp3", &size);
+  if (!AudioStart(&mixer, music, music ? size : 0)) TraceLog(LOG_WARNING, "AUDIO: could not start the audio thread");
+  AudioSend(AUDIO_MUSIC_VOLUME, 0, VOLUME * 0.3);
+  AudioSend(AUDIO_PLAY_MUSIC, 0, 0);
+}
+
+void PlaySfx(Sfx sfx, float x) {
+  AudioSend(AUDIO_SFX, sfx, x);
+}
+
+// Funcao pra checar se e o primeiro frame e desligar a flag
+int StageInEvent() {
+  int tmp = stage_in_event;
+  stage_in_event = 1;
+  return !tmp;
+}
+
+// Entra em um estagio e desativa a flag de primeiro frame
+void SetStage(Stage to) {
+  stage = to;
+  stage_in_event = 0;
+}
+
+// --- Thread da simulacao
+
+void StartSim() {
+  TripleInit(&snapshots);
+  StepperInit(&sim_stepper, game_clock);
+  atomic_store(&sim_running, 1);
+  if (pthread_create(&sim_thread, NULL, SimWorker, NULL)) {
+    fprintf(stderr, "Could not start the simulation thread\n");
+    exit(1);
   }
+}
 
-  if (!IsKeyDown(32)) return;
-  g.player.bullet.x = g.player.pos.x + g.player.pos.width  / 2 - BULLET_WIDTH  / 2.0;
-  g.player.bullet.y = g.player.pos.y + g.player.pos.height / 2 - BULLET_HEIGHT / 2.0;
-  g.player.shooting = 1;
-  PlaySound(assets.s_shoot[GetRandomValue(0, 3)]);
+void StopSim() {
+  atomic_store(&sim_running, 0);
+  pthread_join(sim_thread, NULL);
 }
 
-void EnemiesBulletCollision() {
-  // Loopa todos inimigos
-  for (int i = 0; i < g.enemy_columns; i++) {
-    for (int j = 0; j < g.enemy_lines; j++) {
-      if (!g.enemies[i][j].shooting) continue;
-      // Colisao com o player
-      if (CheckCollisionRecs(g.player.pos, g.enemies[i][j].bullet)) {
-        g.enemies[i][j].shooting = 0;
-        TakeDamage();
-      }
+// Passo fixo: roda quantos ticks couberem desde a ultima volta, vezes a velocidade do replay, e dorme ate o proximo
+// Publica um snapshot por volta e so depois manda os eventos, pra quem desenha nunca ver um evento antes do estado
+// No coop os ticks passam pelo rollback e nunca param; os sons de um tick previsto errado ja tocaram e ficam assim
+// Voltando no tempo cada tick restaura o anterior do historico, sem eventos; a partida deixa de ter replay
+void* SimWorker(void* arg) {
+  static Event batch[EVENT_QUEUE_SIZE];
+
+  while (atomic_load(&sim_running)) {
+    if (!atomic_load_explicit(&sim_active, memory_order_acquire)) {
+      usleep(1000);
+      continue;
+    }
 
-      // Colisao com alguma barreira
-      for (int a = 0; a < LEN(g.barriers); a++) {
-        if (CheckCollisionRecs(g.barriers[a].pos,g.enemies[i][j].bullet) && g.barriers[a].hp) {
-          g.barriers[a].hp -= 1;
-          PlaySound(g.barriers[a].hp ? assets.s_shield : assets.s_break);
-          g.enemies[i][j].shooting = 0;
+    int count = 0, ticked = 0;
+    float prev_x = g.player.pos.x, prev_formation = g.enemies.x[0];
+    uint64_t start = ClockNow(&game_clock);
+    int quick = atomic_exchange(&quick_request, 0);
+    if (quick == 1) RewindQuickSave(&rewind_buffer, &g);
+    if (quick == 2 && RewindQuickLoad(&rewind_buffer, &g)) {
+      ReplayDiscard(&recorder);
+      atomic_store(&practiced, 1);
+      ticked++;
+    }
+    for (int n = StepperAdvance(&sim_stepper) * (playing ? playback_speed : 1); n > 0 && (netplay || !g.over); n--) {
+      Input input = atomic_load(&held) | atomic_exchange(&latched, 0);
+      ReplayStep step;
+      // Sem entrada gravada a sim para aqui; o teclado nunca assume a partida do replay
+      if (playing && (step = ReplayNext(&playback, &input)) != REPLAY_TICK) {
+        FinishPlayback(step);
+        g.over = 1;
+        atomic_store(&playback_cut, 1);
+        break;
+      }
+      prev_x = g.player.pos.x;
+      prev_formation = g.enemies.x[0];
+      if (atomic_load(&rewinding)) {
+        if (RewindSeek(&rewind_buffer, &g, g.tick - 1)) {
+          ReplayDiscard(&recorder);
+          atomic_store(&practiced, 1);
         }
+        ticked++;
+        continue;
       }
+      if (!netplay) SimTick(&g, input);
+      else if (!NetAdvance(&net, input)) break; // Esperando o outro lado
+      ReplayTick(&recorder, input);
+      if (!netplay) RewindPush(&rewind_buffer, &g);
+      for (int i = 0; i < g.num_events && count < LEN(batch); i++) batch[count++] = g.events[i];
+      ticked++;
+    }
+
+    if (ticked) {
+      uint64_t now = ClockNow(&game_clock);
+      atomic_store(&sim_tick_ns, (now - start) / ticked);
+      atomic_store(&net_resim_ns, net.stats.last_resim_ns);
+      SnapshotTake(TripleBack(&snapshots), &g, prev_x, prev_formation, now);
+      TriplePublish(&snapshots);
+    }
+    if (netplay) {
+      atomic_store(&net_rollbacks, net.stats.rollbacks);
+      atomic_store(&net_stalls, net.stats.stalls);
+      atomic_store(&net_max_resim_ns, net.stats.max_resim_ns);
+    }
+    else if (g.over) atomic_store_explicit(&sim_active, 0, memory_order_release);
+    EventQueuePush(&sim_events, batch, count);
 
-      // Colisao com a borda
-      if (CheckCollisionRecs(g.enemies[i][j].bullet, g.borders[1]))
-        g.enemies[i][j].shooting = 0;
+    if (atomic_load(&sim_active)) {
+      uint64_t wait = StepperUntilNext(&sim_stepper);
+      nanosleep(&(struct timespec) { wait / 1000000000, wait % 1000000000 }, NULL);
     }
   }
+  return NULL;
 }
 
-void PlayerBulletCollision() {
-  // Loopa todos inimigos
-  for (int i = 0; i < g.enemy_columns; i++) {
-    for (int j = 0; j < g.enemy_lines; j++) {
-      // Colisao com inimigo
-      if (CheckCollisionRecs(g.enemies[i][j].pos, g.player.bullet) && g.enemies[i][j]. hp) {
-        g.enemies[i][j].hp = 0;
-        g.player.shooting = 0;
-        PlaySound(assets.s_hit);
-        g.pts += 5;
+// --- Replays
 
-        for (int a = 0; a < g.enemy_columns; a++)
-          for (int c = 0; c < g.enemy_lines; c++)
-            if (g.enemies[a][c].hp) return;
+// Assiste uma partida gravada; quando ela acaba o teclado so volta a valer no menu, e nada vai pro historico
+void StartPlayback(char* path, int speed) {
+  if (!ReplayLoad(&playback, path)) {
+    fprintf(stderr, "Could not read replay %s\n", path);
+    exit(1);
+  }
+  ReplayStart(&playback, &g);
+  snprintf(nick, sizeof(nick), "%.3s", playback.header.nick);
+  playing = 1;
+  atomic_store(&practiced, 1);
+  playback_speed = MAX(1, speed);
+  SetStage(GAME_SCREEN);
+}
 
-        WinGame();
-      }
+// Confere o resultado da sim com o gravado; step e o que o replay tinha depois do ultimo tick
+void FinishPlayback(ReplayStep step) {
+  if (!playing) return;
+  int ok = step == REPLAY_END && g.pts == playback.pts && g.level == playback.level;
+  TraceLog(ok ? LOG_INFO : LOG_WARNING, "REPLAY: recorded level %d pts %d, simulated level %d pts %d: %s",
+           playback.level, playback.pts, g.level, g.pts, ok ? "OK" : "MISMATCH");
+  playing = 0;
+  g.masks = &sprite_masks;
+}
 
-      // Colisao com alguma barreira
-      for (int k = 0; k < LEN(g.barriers); k++)
-        if (CheckCollisionRecs(g.barriers[k].pos, g.player.bullet) && g.barriers[k].hp)
-          g.player.shooting = 0;
+// --- Coop pela rede
 
-      // Colisao com a borda
-      if (CheckCollisionRecs(g.player.bullet, g.borders[0]))
-        g.player.shooting = 0;
-    }
+// Abre a porta e espera o outro lado desenhando so um aviso; a semente e o modo sao os do host
+void StartNetplay(int port, char* peer, int latency, float loss) {
+  if (!NetOpen(&net, port, peer, GetRandomValue(1, 1 << 30), g.mode)) {
+    fprintf(stderr, "Could not open UDP port %d\n", port);
+    exit(1);
   }
+  net.latency_ms = latency;
+  net.loss = loss;
+
+  while (!NetPoll(&net)) {
+    if (WindowShouldClose()) exit(0);
+    BeginDrawing();
+    ClearBackground(BACKGROUND_COLOR);
+    const char* message = peer ? TextFormat("JOINING %s", peer) : TextFormat("WAITING ON PORT %d", port);
+    DrawText(message, (WINDOW_WIDTH - MeasureText(message, 30)) / 2, WINDOW_HEIGHT / 2 - 15, 30, GRAY);
+    EndDrawing();
+  }
+
+  NetStart(&net, &g);
+  snprintf(nick, sizeof(nick), "%s", peer ? "P2" : "P1");
+  netplay = 1;
+  SetStage(GAME_SCREEN);
 }
 
-// Reduz o HP e finaliza a partida se chegar em 0
-void TakeDamage() {
-  if (player_immune) return;
-  PlaySound(assets.s_damage);
-  player_immune = 30;
-  background_color.r += DAMAGE_REDNESS;
-  if (--g.player.hp) PlaySound(assets.s_hit);
-  else LoseGame();
+// --- Assets
+
+// Abre o pacote e comeca a decodificar em paralelo enquanto a janela e o audio sobem
+void StartAssetDecode() {
+  asset_timing[0] = ClockNow(&game_clock);
+  char path[1024];
+  snprintf(path, sizeof(path), "%s%s", GetApplicationDirectory(), PACK_FILE);
+  if (!PackOpen(&pack, path)) {
+    fprintf(stderr, "Could not open %s, run ./run.sh to build it\n", path);
+    exit(1);
+  }
+  asset_timing[1] = ClockNow(&game_clock);
+
+  num_workers = MIN(MAX_LOAD_THREADS, MAX(1, sysconf(_SC_NPROCESSORS_ONLN)));
+  atomic_store(&next_job, 0);
+  for (int i = 0; i < num_workers; i++) pthread_create(&workers[i], NULL, DecodeWorker, NULL);
 }
 
-// Finaliza o round com vitoria
-void WinGame() {
-  StartAnimation(&a_player_out);
-  SetStage(END_SCREEN);
-  PlaySound(assets.s_hit);
-  g.winner = 1;
-  g.pts += 100 * (g.mode + 1);
-  g.player.shooting = 0;
+// Cada worker pega o proximo asset da fila e decodifica so na CPU
+void* DecodeWorker(void* arg) {
+  int num_jobs = LEN(image_names) + LEN(sound_names);
+  for (int j; (j = atomic_fetch_add(&next_job, 1)) < num_jobs;) {
+    int size;
+    if (j < LEN(image_names)) {
+      const unsigned char* data = PackFind(&pack, image_names[j], &size);
+      if (data) images[j] = LoadImageFromMemory(".png", data, size);
+    }
+    else {
+      const unsigned char* data = PackFind(&pack, sound_names[j - LEN(image_names)], &size);
+      if (!data) continue;
+      // O mixer so toca mono em float na taxa dele
+      Wave* wave = &waves[j - LEN(image_names)];
+      *wave = LoadWaveFromMemory(".wav", data, size);
+      if (wave->data) WaveFormat(wave, MIXER_RATE, 32, 1);
+    }
+  }
+  return NULL;
 }
 
-// Finaliza o round com derrota
-void LoseGame() {
-  SetStage(END_SCREEN);
-  PlaySound(assets.s_death);
-  g.winner = 0;
-  WriteRank();
+// Espera os workers e sobe tudo pra GPU, que so pode ser usada na thread principal; os sons ficam com o mixer
+void LoadAssets() {
+  for (int i = 0; i < num_workers; i++) pthread_join(workers[i], NULL);
+  asset_timing[2] = ClockNow(&game_clock);
+
+  for (int i = 0; i < LEN(image_names); i++) {
+    if (images[i].data) continue;
+    fprintf(stderr, "Missing or broken %s in %s\n", image_names[i], PACK_FILE);
+    exit(1);
+  }
+
+  LoadMasks();
+  LoadBarriers();
+  LoadAtlas();
+  LoadTextFont();
+  asset_timing[3] = ClockNow(&game_clock);
+
+  TraceLog(LOG_INFO, "ASSETS: map %.2f ms, decode %.2f ms (%d threads), upload %.2f ms, total %.2f ms",
+           (asset_timing[1] - asset_timing[0]) / 1e6, (asset_timing[2] - asset_timing[1]) / 1e6, num_workers,
+           (asset_timing[3] - asset_timing[2]) / 1e6, (asset_timing[3] - asset_timing[0]) / 1e6);
 }
 
-// Funcao pra checar se e o primeiro frame e desligar a flag
-int StageInEvent() {
-  int tmp = stage_in_event;
-  stage_in_event = 1;
-  return !tmp;
+// Junta todos os sprites numa textura so, empacotando em prateleiras
+void LoadAtlas() {
+  Rectangle* regions[] = { &assets.player[0], &assets.player[1], &assets.player[2], &assets.enemy, &assets.white };
+
+  Image atlas = GenImageColor(ATLAS_SIZE, ATLAS_SIZE, BLANK);
+  int x = 0, y = 0, shelf = 0;
+  for (int i = 0; i < LEN(regions); i++) {
+    // O ultimo e um bloco branco pros retangulos lisos
+    Image image = i < LEN(regions) - 1 ? images[i] : GenImageColor(4, 4, WHITE);
+    if (x + image.width > ATLAS_SIZE) {
+      x = 0;
+      y += shelf + ATLAS_PADDING;
+      shelf = 0;
+    }
+    *regions[i] = (Rectangle) { x, y, image.width, image.height };
+    ImageDraw(&atlas, image, (Rectangle) { 0, 0, image.width, image.height }, *regions[i], WHITE);
+    x += image.width + ATLAS_PADDING;
+    shelf = MAX(shelf, image.height);
+    UnloadImage(image);
+  }
+
+  // Amostra so o miolo do bloco branco pra nao pegar a borda
+  assets.white = (Rectangle) { assets.white.x + 1, assets.white.y + 1, 2, 2 };
+  assets.atlas = LoadTextureFromImage(atlas);
+  textures[TEX_ATLAS] = assets.atlas;
+  UnloadImage(atlas);
 }
 
-// Entra em um estagio e desativa a flag de primeiro frame
-void SetStage(Stage stage) {
-  g.stage = stage;
-  stage_in_event = 0;
+// Mascaras de colisao dos sprites, antes do LoadAtlas liberar as imagens
+// O enemy.png tem os dois frames lado a lado
+void LoadMasks() {
+  for (int i = 0; i < LEN(sprite_masks.player); i++) BuildMask(images[i], 0, &sprite_masks.player[i]);
+  for (int i = 0; i < LEN(sprite_masks.enemy); i++) BuildMask(images[3], i * SPRITE_SIZE, &sprite_masks.enemy[i]);
+  BuildMask(images[4], 0, &sprite_masks.barrier);
 }
 
-// --- Assets
+// Guarda as cores da barreira e cria a textura delas vazia; o DrawBarriers sobe os pixels conforme a sim
+void LoadBarriers() {
+  Image image = images[4];
+  Color* pixels = LoadImageColors(image);
+  for (int y = 0; y < MIN(image.height, SPRITE_SIZE); y++)
+    for (int x = 0; x < MIN(image.width, SPRITE_SIZE); x++)
+      barrier_base[y * SPRITE_SIZE + x] = pixels[y * image.width + x];
+  UnloadImageColors(pixels);
+  UnloadImage(image);
+
+  Image blank = GenImageColor(SPRITE_SIZE * LEN(g.barriers), SPRITE_SIZE, BLANK);
+  assets.barriers = LoadTextureFromImage(blank);
+  textures[TEX_BARRIERS] = assets.barriers;
+  UnloadImage(blank);
+}
 
-void LoadAssets() {
-  assets.music      = LoadMusicStream("assets/soundtrack.mp3");
-  assets.enemy      = LoadTexture("assets/enemy.png");
-  assets.player[0]  = LoadTexture("assets/player0.png");
-  assets.player[1]  = LoadTexture("assets/player1.png");
-  assets.player[2]  = LoadTexture("assets/player2.png");
-  assets.barrier[0] = LoadTexture("assets/barrier0.png");
-  assets.barrier[1] = LoadTexture("assets/barrier1.png");
-  assets.barrier[2] = LoadTexture("assets/barrier2.png");
-  assets.barrier[3] = LoadTexture("assets/barrier3.png");
-  assets.s_key      = LoadSound("assets/key.wav");
-  assets.s_undo     = LoadSound("assets/undo.wav");
-  assets.s_enter    = LoadSound("assets/enter.wav");
-  assets.s_hit      = LoadSound("assets/hit.wav");
-  assets.s_nop      = LoadSound("assets/nop.wav");
-  assets.s_death    = LoadSound("assets/death.wav");
-  assets.s_shoot[0] = LoadSound("assets/shoot_1.wav");
-  assets.s_shoot[1] = LoadSound("assets/shoot_2.wav");
-  assets.s_shoot[2] = LoadSound("assets/shoot_3.wav");
-  assets.s_shoot[3] = LoadSound("assets/shoot_4.wav");
-  assets.s_e_shoot  = LoadSound("assets/shoot.wav");
-  assets.s_damage  = LoadSound("assets/damage.wav");
-  assets.s_shield  = LoadSound("assets/shield.wav");
-  assets.s_break  = LoadSound("assets/break.wav");
+// Pixel com mais da metade do alfa conta como opaco
+void BuildMask(Image image, int x0, SpriteMask* mask) {
+  Color* pixels = LoadImageColors(image);
+  *mask = (SpriteMask) { 0 };
+  for (int y = 0; y < MIN(image.height, SPRITE_SIZE); y++)
+    for (int x = 0; x < SPRITE_SIZE && x0 + x < image.width; x++)
+      if (pixels[y * image.width + x0 + x].a > 127) mask->rows[y] |= 1u << x;
+  UnloadImageColors(pixels);
+}
+
+// Copia as metricas da fonte padrao pro cache de layout
+void LoadTextFont() {
+  Font f = GetFontDefault();
+  font = (TextFont) { f.baseSize, f.glyphPadding, TEX_FONT };
+  for (int i = 0; i < TEXT_GLYPHS; i++) {
+    int index = GetGlyphIndex(f, TEXT_FIRST + i);
+    GlyphInfo* glyph = &f.glyphs[index];
+    font.glyphs[i] = (TextGlyph) { f.recs[index], glyph->offsetX, glyph->offsetY, glyph->advanceX ? glyph->advanceX : f.recs[index].width };
+  }
+  textures[TEX_FONT] = f.texture;
+  TextCacheClear(&text_cache);
 }
 
 void UnloadAssets() {
-  UnloadMusicStream(assets.music);
-  UnloadTexture(assets.player[0]);
-  UnloadTexture(assets.player[1]);
-  UnloadTexture(assets.player[2]);
-  UnloadTexture(assets.enemy);
-  UnloadTexture(assets.barrier[0]);
-  UnloadTexture(assets.barrier[1]);
-  UnloadTexture(assets.barrier[2]);
-  UnloadTexture(assets.barrier[3]);
-  UnloadSound(assets.s_key);
-  UnloadSound(assets.s_undo);
-  UnloadSound(assets.s_enter);
-  UnloadSound(assets.s_hit);
-  UnloadSound(assets.s_nop);
-  UnloadSound(assets.s_death);
-  UnloadSound(assets.s_shoot[0]);
-  UnloadSound(assets.s_shoot[1]);
-  UnloadSound(assets.s_shoot[2]);
-  UnloadSound(assets.s_shoot[3]);
-  UnloadSound(assets.s_e_shoot);
-  UnloadSound(assets.s_damage);
-  UnloadSound(assets.s_shield);
-  UnloadSound(assets.s_break);
+  AudioStop();
+  UnloadTexture(assets.atlas);
+  UnloadTexture(assets.barriers);
+  for (int i = 0; i < LEN(sound_names); i++) UnloadWave(waves[i]);
+  PackClose(&pack);
 }
 
 // --- Animacoes
 
 void StartAnimation(Animation* anim) {
-  anim->start   = GetTime();
+  anim->start   = ClockNow(&game_clock);
   anim->running = 1;
 }
 
@@ -766,16 +1304,56 @@ void DrawTransition() {
     DrawRectangle(0, +WINDOW_HEIGHT - x / transition.duration * 2 * WINDOW_HEIGHT, WINDOW_WIDTH, WINDOW_HEIGHT, BLACK);
 }
 
+// Interpolacao
+
+// Chamado antes de cada tick e quando o estado pula (round novo, tela final)
+// O player so anda em x e a formacao inteira anda junto, entao basta um x de cada
+void SavePrevious() {
+  prev_player_x = g.player.pos.x;
+  prev_formation_x = g.enemies.count ? g.enemies.x[0] : 0;
+}
+
+float FormationOffset() {
+  return view->enemies.count ? (view->enemies.x[0] - prev_formation_x) * (alpha - 1) : 0;
+}
+
 // Utils
 
 float Shake(float offset, float speed, float intensity) {
-  return sin((GetTime() + offset) * speed) * intensity;
+  return sin((Seconds() + offset) * speed) * intensity;
 }
 
-float TimeSince(float x) {
-  return GetTime() - x;
+// Segundos desde um instante do relogio do jogo
+double TimeSince(uint64_t ns) {
+  return (ClockNow(&game_clock) - ns) / 1e9;
+}
+
+// Segundos desde que o jogo abriu, com precisao de sobra mesmo depois de dias ligado
+double Seconds() {
+  return TimeSince(boot_time);
+}
+
+// O layout vem do cache e os glifos vao pra lista na camada de texto, por cima do que ja foi empilhado
+void DrawCenteredText(const char* str, int size, int x, int y, Color color) {
+  TextLayout* t = TextLayoutGet(&text_cache, &font, str, size);
+  float left = WINDOW_WIDTH / 2 - (int) t->width / 2 + x;
+  for (int i = t->first; i < t->first + t->count; i++) {
+    TextQuad* q = &text_cache.quads[i];
+    PushQuad(LAYER_TEXT, TEX_FONT, q->src, (Rectangle) { left + q->dst.x, y + q->dst.y, q->dst.width, q->dst.height }, color);
+  }
 }
 
-void DrawCenteredText(char* str, int size, int x, int y, Color color) {
-  DrawText(str, WINDOW_WIDTH / 2 - MeasureText(str, size) / 2 + x, y, size, color);
+// Formata numa string que vale ate o fim do frame
+char* ScratchFormat(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int len = vsnprintf(NULL, 0, fmt, args);
+  va_end(args);
+
+  char* str = ArenaPush(&scratch, len + 1);
+  if (!str) return "";
+  va_start(args, fmt);
+  vsnprintf(str, len + 1, fmt, args);
+  va_end(args);
+  return str;
 }
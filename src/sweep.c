@@ -0,0 +1,285 @@
+// Varredura de dificuldade: muitos rounds headless por conjunto de parametros, modo e level
+// Uso: ./sweep [--rounds N] [--levels A-B] [--modes 0,1,2] [--policy idle|random|track]
+//              [--threads N] [--seed S] [--speed 0.8,1,1.2] [--bullet ...] [--fire ...] [--hp ...] [--ramp ...]
+// Os parametros multiplicam os da DEFAULT_DIFFICULTY; cada lista vira um eixo do produto cartesiano
+// Imprime CSV no stdout, uma linha por celula; o progresso vai pro stderr
+
+#include "sim.h"
+#include "policy.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define MAX_VALUES      8
+#define MAX_THREADS     64
+#define MAX_ROUND_TICKS (TICK_RATE * 120)
+
+typedef enum {
+  AXIS_SPEED, AXIS_BULLET, AXIS_FIRE, AXIS_HP, AXIS_RAMP, AXIS_COUNT
+} AxisId;
+
+typedef struct {
+  char* name;
+  float values[MAX_VALUES];
+  int count;
+} Axis;
+
+// Uma celula da varredura; so a thread que pegou escreve nela
+typedef struct {
+  int params, mode, level;
+  int wins, hp_left;
+  int* pts;   // Pontos de cada round
+  int* clear; // Ticks ate limpar a formacao, so dos rounds ganhos
+  long ticks;
+} Job;
+
+// Faixa [head, tail) de jobs de uma thread num inteiro so, pra dono e ladrao usarem o mesmo CAS
+// O dono tira do fim e quem rouba tira do comeco
+typedef struct {
+  _Atomic uint64_t range;
+  char pad[64 - sizeof(uint64_t)]; // Cada fila na sua linha de cache
+} Deque;
+
+Axis axes[AXIS_COUNT] = {
+  { "speed",  { 1 }, 1 }, { "bullet", { 1 }, 1 }, { "fire", { 1 }, 1 },
+  { "hp",     { 1 }, 1 }, { "ramp",   { 1 }, 1 }
+};
+
+Job* jobs;
+int num_jobs, num_threads, rounds = 200;
+int modes[3] = { NORMAL, HARD, HARDCORE }, num_modes = 3;
+int first_level = 1, last_level = 20;
+uint64_t seed = 1;
+Policy policy = PolicyTrack;
+
+Deque deques[MAX_THREADS];
+atomic_int jobs_done;
+atomic_int worker_failed; // Uma thread sem memoria pra sim; o main desiste em vez de esperar as celulas dela
+atomic_long ticks_done;
+
+// ---
+
+uint64_t SplitMix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+// Indice do conjunto de parametros -> valor de cada eixo, o primeiro eixo varia mais rapido
+float AxisValue(int params, AxisId axis) {
+  for (int a = 0; a < axis; a++) params /= axes[a].count;
+  return axes[axis].values[params % axes[axis].count];
+}
+
+Difficulty MakeDifficulty(int params) {
+  Difficulty d = DEFAULT_DIFFICULTY;
+  for (int m = 0; m < 3; m++) {
+    d.enemy_speed[m]        *= AxisValue(params, AXIS_SPEED);
+    d.enemy_bullet_speed[m] *= AxisValue(params, AXIS_BULLET);
+    d.enemy_shoot_timer[m]  *= AxisValue(params, AXIS_FIRE);
+    d.barrier_hp[m]          = MAX(1, d.barrier_hp[m] * AxisValue(params, AXIS_HP) + 0.5);
+  }
+  d.ramp     *= AxisValue(params, AXIS_RAMP);
+  d.ramp_max *= AxisValue(params, AXIS_RAMP);
+  return d;
+}
+
+// Cada round comeca direto no level da celula; a semente so depende do indice, nao da thread
+void RunJob(Game* g, int index) {
+  Job* job = &jobs[index];
+  uint64_t job_seed = SplitMix(seed ^ SplitMix(index));
+  PolicyState state = { job_seed, 0 };
+  g->rng = job_seed | 1;
+  g->difficulty = MakeDifficulty(job->params);
+
+  for (int r = 0; r < rounds; r++) {
+    SimNewRun(g);
+    g->mode = job->mode;
+    g->level = job->level - 1;
+    SimStartRound(g);
+
+    int tick = 0;
+    while (!g->over && tick < MAX_ROUND_TICKS) {
+      tick++;
+      SimTick(g, policy(g, &state));
+    }
+
+    job->pts[r] = g->pts;
+    job->ticks += tick;
+    if (g->winner) {
+      job->clear[job->wins++] = tick;
+      job->hp_left += g->player.hp;
+    }
+  }
+}
+
+// Pega o ultimo job da propria fila, -1 se vazia
+int TakeJob(Deque* d) {
+  uint64_t range = atomic_load(&d->range);
+  for (;;) {
+    uint32_t head = range >> 32, tail = range;
+    if (head >= tail) return -1;
+    if (atomic_compare_exchange_weak(&d->range, &range, (uint64_t) head << 32 | (tail - 1))) return tail - 1;
+  }
+}
+
+// Rouba o primeiro job da fila de outra thread, -1 se vazia
+int StealJob(Deque* d) {
+  uint64_t range = atomic_load(&d->range);
+  for (;;) {
+    uint32_t head = range >> 32, tail = range;
+    if (head >= tail) return -1;
+    if (atomic_compare_exchange_weak(&d->range, &range, (uint64_t) (head + 1) << 32 | tail)) return head;
+  }
+}
+
+// Esvazia a propria fila e depois rouba das outras ate nao sobrar nada
+void* Worker(void* arg) {
+  int id = (int) (intptr_t) arg;
+  Game g;
+  if (!SimInit(&g, 1)) {
+    atomic_store(&worker_failed, 1);
+    return NULL;
+  }
+
+  for (;;) {
+    int job = TakeJob(&deques[id]);
+    for (int v = 1; job < 0 && v < num_threads; v++) job = StealJob(&deques[(id + v) % num_threads]);
+    if (job < 0) break;
+
+    RunJob(&g, job);
+    atomic_fetch_add(&jobs_done, 1);
+    atomic_fetch_add(&ticks_done, jobs[job].ticks);
+  }
+  SimFree(&g);
+  return NULL;
+}
+
+// ---
+
+int CompareInts(const void* a, const void* b) {
+  return *(int*) a - *(int*) b;
+}
+
+// Percentil de um array ja ordenado
+int Percentile(int* values, int n, int p) {
+  return values[MIN(n - 1, n * p / 100)];
+}
+
+void Report() {
+  printf("speed,bullet,fire,hp,ramp,mode,level,rounds,survival,clear_p10_s,clear_p50_s,clear_p90_s,"
+         "pts_p10,pts_p50,pts_p90,pts_mean,hp_left_mean\n");
+  for (int i = 0; i < num_jobs; i++) {
+    Job* job = &jobs[i];
+    qsort(job->pts, rounds, sizeof(int), CompareInts);
+    qsort(job->clear, job->wins, sizeof(int), CompareInts);
+    long sum = 0;
+    for (int r = 0; r < rounds; r++) sum += job->pts[r];
+
+    for (int a = 0; a < AXIS_COUNT; a++) printf("%g,", AxisValue(job->params, a));
+    printf("%d,%d,%d,%.4f,", job->mode, job->level, rounds, (double) job->wins / rounds);
+    if (job->wins)
+      printf("%.2f,%.2f,%.2f,", Percentile(job->clear, job->wins, 10) / (double) TICK_RATE,
+             Percentile(job->clear, job->wins, 50) / (double) TICK_RATE, Percentile(job->clear, job->wins, 90) / (double) TICK_RATE);
+    else printf(",,,");
+    printf("%d,%d,%d,%.1f,", Percentile(job->pts, rounds, 10), Percentile(job->pts, rounds, 50), Percentile(job->pts, rounds, 90),
+           (double) sum / rounds);
+    if (job->wins) printf("%.2f\n", (double) job->hp_left / job->wins);
+    else printf("\n");
+  }
+}
+
+// "0.8,1,1.2" -> valores do eixo
+void ParseList(Axis* axis, char* list) {
+  axis->count = 0;
+  for (char* s = strtok(list, ","); s && axis->count < MAX_VALUES; s = strtok(NULL, ","))
+    axis->values[axis->count++] = atof(s);
+  if (!axis->count) axis->values[axis->count++] = 1;
+}
+
+int main(int argc, char** argv) {
+  num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  for (int i = 1; i < argc - 1; i++) {
+    int axis = -1;
+    for (int a = 0; a < AXIS_COUNT; a++)
+      if (!strncmp(argv[i], "--", 2) && !strcmp(argv[i] + 2, axes[a].name)) axis = a;
+
+    if      (axis >= 0)                      ParseList(&axes[axis], argv[++i]);
+    else if (!strcmp(argv[i], "--rounds"))  rounds      = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--threads")) num_threads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--seed"))    seed        = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--policy"))  policy      = PolicyByName(argv[++i]);
+    else if (!strcmp(argv[i], "--levels"))  sscanf(argv[++i], "%d-%d", &first_level, &last_level);
+    else if (!strcmp(argv[i], "--modes")) {
+      num_modes = 0;
+      for (char* s = strtok(argv[++i], ","); s && num_modes < 3; s = strtok(NULL, ","))
+        modes[num_modes++] = MIN(HARDCORE, MAX(NORMAL, atoi(s)));
+    }
+  }
+  rounds      = MAX(1, rounds);
+  num_threads = MIN(MAX_THREADS, MAX(1, num_threads));
+  first_level = MAX(1, first_level);
+  last_level  = MAX(first_level, last_level);
+
+  int num_params = 1, num_levels = last_level - first_level + 1;
+  for (int a = 0; a < AXIS_COUNT; a++) num_params *= axes[a].count;
+  num_jobs = num_params * num_modes * num_levels;
+
+  jobs = calloc(num_jobs, sizeof(Job));
+  int* samples = malloc((size_t) num_jobs * rounds * 2 * sizeof(int));
+  if (!jobs || !samples) {
+    fprintf(stderr, "Out of memory\n");
+    return 1;
+  }
+  for (int i = 0; i < num_jobs; i++) {
+    jobs[i].params = i / (num_modes * num_levels);
+    jobs[i].mode   = modes[i / num_levels % num_modes];
+    jobs[i].level  = first_level + i % num_levels;
+    jobs[i].pts    = samples + (size_t) i * rounds * 2;
+    jobs[i].clear  = jobs[i].pts + rounds;
+  }
+
+  // Cada thread comeca com uma fatia continua; os levels altos acabam rapido e quem sobra rouba
+  for (int t = 0; t < num_threads; t++) {
+    uint64_t head = (uint64_t) num_jobs * t / num_threads, tail = (uint64_t) num_jobs * (t + 1) / num_threads;
+    atomic_store(&deques[t].range, head << 32 | tail);
+  }
+
+  fprintf(stderr, "%d cells x %d rounds on %d threads\n", num_jobs, rounds, num_threads);
+  uint64_t start = MonotonicNs(NULL);
+  pthread_t threads[MAX_THREADS];
+  // Uma thread que nao subiu deixa a fila dela pras outras roubarem; sem nenhuma nao tem quem rode
+  int started[MAX_THREADS], num_started = 0;
+  for (int t = 0; t < num_threads; t++) {
+    started[t] = !pthread_create(&threads[t], NULL, Worker, (void*) (intptr_t) t);
+    num_started += started[t];
+  }
+  if (!num_started) {
+    fprintf(stderr, "Could not start any worker thread\n");
+    return 1;
+  }
+
+  while (atomic_load(&jobs_done) < num_jobs) {
+    if (atomic_load(&worker_failed)) {
+      fprintf(stderr, "\nOut of memory\n");
+      return 1;
+    }
+    usleep(200000);
+    fprintf(stderr, "\r%d/%d cells", atomic_load(&jobs_done), num_jobs);
+  }
+  for (int t = 0; t < num_threads; t++)
+    if (started[t]) pthread_join(threads[t], NULL);
+
+  double elapsed = (MonotonicNs(NULL) - start) / 1e9;
+  fprintf(stderr, "\r%d cells, %ld ticks in %.2fs (%.0f ticks/s)\n", num_jobs, atomic_load(&ticks_done), elapsed,
+          atomic_load(&ticks_done) / elapsed);
+
+  Report();
+  free(samples);
+  free(jobs);
+  return 0;
+}
@@ -0,0 +1,74 @@
+#include "text.h"
+#include <string.h>
+
+static uint32_t Hash(const TextFont* font, const char* str, int len, int size);
+static void     Layout(TextCache* c, TextLayout* t, const char* str, int len);
+
+void TextCacheClear(TextCache* c) {
+  for (int i = 0; i < TEXT_CACHE_SIZE; i++) c->entries[i].hash = 0;
+  c->num_entries = c->num_quads = 0;
+}
+
+// Endereco aberto com sondagem linear; o layout so e montado na primeira vez que a string aparece
+TextLayout* TextLayoutGet(TextCache* c, const TextFont* font, const char* str, int size) {
+  int len = strnlen(str, TEXT_MAX_LEN - 1);
+  uint32_t hash = Hash(font, str, len, size), mask = TEXT_CACHE_SIZE - 1;
+
+  for (uint32_t i = hash & mask; c->entries[i].hash; i = (i + 1) & mask) {
+    TextLayout* t = &c->entries[i];
+    if (t->hash == hash && t->font == font && t->size == size && !strncmp(t->str, str, len) && !t->str[len]) {
+      c->hits++;
+      return t;
+    }
+  }
+
+  // Cheio: joga tudo fora, as strings do frame voltam sozinhas
+  c->misses++;
+  if (c->num_entries >= TEXT_CACHE_SIZE * 3 / 4 || c->num_quads + len > TEXT_MAX_QUADS) {
+    TextCacheClear(c);
+    c->clears++;
+  }
+
+  uint32_t i = hash & mask;
+  while (c->entries[i].hash) i = (i + 1) & mask;
+  TextLayout* t = &c->entries[i];
+  t->hash = hash;
+  t->font = font;
+  t->size = size;
+  memcpy(t->str, str, len);
+  t->str[len] = '\0';
+  Layout(c, t, str, len);
+  c->num_entries++;
+  return t;
+}
+
+// ---
+
+// FNV-1a da string, misturado com a fonte e o tamanho; nunca 0, que marca entrada livre
+static uint32_t Hash(const TextFont* font, const char* str, int len, int size) {
+  uint32_t h = 2166136261u ^ (uint32_t) (uintptr_t) font ^ (uint32_t) size * 0x9E3779B9u;
+  for (int i = 0; i < len; i++) h = (h ^ (uint8_t) str[i]) * 16777619u;
+  return h ? h : 1;
+}
+
+// Mesmas contas do DrawText do raylib: tamanho minimo e o base, espacamento inteiro de size / base
+static void Layout(TextCache* c, TextLayout* t, const char* str, int len) {
+  const TextFont* f = t->font;
+  int size = MAX(t->size, f->base_size);
+  float scale = (float) size / f->base_size, spacing = size / f->base_size, p = f->padding, x = 0;
+
+  t->first = c->num_quads;
+  for (int i = 0; i < len; i++) {
+    int ch = (uint8_t) str[i];
+    const TextGlyph* g = &f->glyphs[ch >= TEXT_FIRST && ch < TEXT_FIRST + TEXT_GLYPHS ? ch - TEXT_FIRST : '?' - TEXT_FIRST];
+    if (ch != ' ') {
+      Rectangle src = { g->src.x - p, g->src.y - p, g->src.width + 2 * p, g->src.height + 2 * p };
+      Rectangle dst = { x + (g->offset_x - p) * scale, (g->offset_y - p) * scale, src.width * scale, src.height * scale };
+      c->quads[c->num_quads++] = (TextQuad) { src, dst };
+    }
+    x += g->advance * scale + spacing;
+  }
+  t->count  = c->num_quads - t->first;
+  t->width  = len ? x - spacing : 0;
+  t->height = size;
+}
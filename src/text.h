@@ -0,0 +1,51 @@
+#ifndef TEXT_H
+#define TEXT_H
+
+// Cache de layout de texto: largura medida e quads de cada glifo, por (fonte, tamanho, string)
+// Uma string que ja apareceu so custa o hash; quando enche, o cache inteiro e descartado e refeito
+// Sem raylib, a apresentacao copia as metricas da fonte e desenha os quads
+
+#include "sim.h"
+#include <stdint.h>
+
+#define TEXT_FIRST      32  // So ASCII imprimivel, o resto vira '?'
+#define TEXT_GLYPHS     95
+#define TEXT_MAX_LEN    64  // Strings maiores sao cortadas
+#define TEXT_CACHE_SIZE 256 // Potencia de 2
+#define TEXT_MAX_QUADS  8192
+
+typedef struct {
+  Rectangle src; // Regiao na textura da fonte
+  float offset_x, offset_y, advance;
+} TextGlyph;
+
+// Metricas no tamanho base; texture e o indice da textura na lista de desenho
+typedef struct {
+  int base_size, padding, texture;
+  TextGlyph glyphs[TEXT_GLYPHS];
+} TextFont;
+
+typedef struct {
+  Rectangle src, dst; // dst relativo ao canto de cima a esquerda do texto
+} TextQuad;
+
+typedef struct {
+  uint32_t hash; // 0 = livre
+  const TextFont* font;
+  int size;
+  char str[TEXT_MAX_LEN];
+  float width, height;
+  int first, count; // Quads no pool do cache
+} TextLayout;
+
+typedef struct {
+  TextLayout entries[TEXT_CACHE_SIZE];
+  TextQuad quads[TEXT_MAX_QUADS];
+  int num_entries, num_quads;
+  long hits, misses, clears;
+} TextCache;
+
+void TextCacheClear(TextCache* c);
+TextLayout* TextLayoutGet(TextCache* c, const TextFont* font, const char* str, int size);
+
+#endif
@@ -0,0 +1 @@
+gcc -O3 src/sweep.c src/sim.c src/collide.c src/arena.c src/clock.c src/policy.c -o sweep -lm -lpthread && ./sweep "$@"